@@ -1,46 +1,83 @@
 #include <stdio.h>
 #include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
 #include <unistd.h>
+#include <getopt.h>
 
 #include <mpi/mpi.h>
+#include <omp.h>
+
+#include "../simd/gol_kernel.h"
+#include "../simd/gol_vtk.h"
+#include "../simd/gol_snapshot.h"
+#include "../simd/gol_checkpoint.h"
+#include "../simd/gol_rle.h"
+#include "../simd/gol_timing.h"
+#include "../simd/gol_random.h"
+#include "../simd/gol_ensemble.h"
 
 #define calcIndex(width, x, y)  ((y)*(width) + (x))
 
+// cells are bit-packed: 64 cells per row word, cell x is bit (x % 64) of word (x / 64)
+#define WORD_BITS 64
+#define calcWords(width)  (((width) + WORD_BITS - 1) / WORD_BITS)
+#define getCell(field, words, x, y)  (((field)[calcIndex(words, (x) / WORD_BITS, y)] >> ((x) % WORD_BITS)) & 1)
+
 int rank;
-int right_neighbor, left_neighbor, top_neighbor, bottom_neighbor;
+
+// the eight neighbour directions (dx, dy), the opposite of direction d is 7 - d
+#define DIRECTIONS 8
+static const int directions[DIRECTIONS][2] = {{-1, -1}, {0, -1}, {1, -1}, {-1, 0}, {1, 0}, {-1, 1}, {0, 1}, {1, 1}};
+#define LEFT 3
+#define RIGHT 4
+#define TOP 1
+#define BOTTOM 6
+int neighbours[DIRECTIONS];
+
+// rows computed between two tests of the requests of a halo exchange in flight
+#define POLL_ROWS 64
+// temporal bands are cut until every thread gets at least this many
+#define UNITS_PER_THREAD 4
+GolRowKernel rowKernel;
+// OpenMP threads per rank, the halo exchange is funnelled through the master thread
+int threadCount = 1;
+// seconds per phase of every thread of the rank, the threads book their evolve work here
+GolTimes *threadTimes;
+// generations that can wait for the I/O thread before the rank blocks
+#define SNAPSHOT_BUFFERS 3
+// default seed of the random initial field, the same as in the OpenMP build
+#define SEED (42 * 0x815)
+// seed of the random initial field, recorded in the checkpoints
+uint64_t seed = SEED;
+// rule the cells evolve by, recorded in the checkpoints
+GolRule rule;
+
+// cell payload of the vtk files and whether the appended data is zlib-compressed
+GolVtkFormat vtkFormat = GOL_VTK_FLOAT32;
+int vtkCompress = 0;
 
 //#define performance
 
-void writeVTK2(long timestep, const double *data, char prefix[1024], int processWidth, int processHeight, int offsetX, int offsetY, int px, int coordinates[2]) {
+void writeVTK2(long timestep, const uint64_t *data, char prefix[1024], int processWidth, int processHeight, int halo, int offsetX, int offsetY, int px, int coordinates[2]) {
     char filename[2048];
-    int x, y;
-
-    long nxy = processWidth * processHeight * sizeof(float);
+    int words = calcWords(processWidth);
 
     snprintf(filename, sizeof(filename), "%s-%05ld-%03d%s", prefix, timestep, px* coordinates[1] + coordinates[0], ".vti");
     FILE *fp = fopen(filename, "w");
 
     fprintf(fp, "<?xml version=\"1.0\"?>\n");
-    fprintf(fp, "<VTKFile type=\"ImageData\" version=\"0.1\" byte_order=\"LittleEndian\" header_type=\"UInt64\">\n");
+    fprintf(fp, "<VTKFile type=\"ImageData\" version=\"0.1\" byte_order=\"LittleEndian\" header_type=\"UInt64\"%s>\n",
+            golVtkCompressor(vtkCompress));
     fprintf(fp, "<ImageData WholeExtent=\"%d %d %d %d 0 0\" Origin=\"0 0 0\" Spacing=\"1.0 1.0 0.0\">\n", offsetX,
-            offsetX + processWidth - 2, offsetY, offsetY + processHeight - 2);
+            offsetX + processWidth - 2 * halo, offsetY, offsetY + processHeight - 2 * halo);
     fprintf(fp, "<CellData Scalars=\"%s\">\n", prefix);
-    fprintf(fp, "<DataArray type=\"Float32\" Name=\"%s\" format=\"appended\" offset=\"0\"/>\n", prefix);
+    fprintf(fp, "<DataArray type=\"%s\" Name=\"%s\" format=\"appended\" offset=\"0\"/>\n", golVtkTypeName(vtkFormat), prefix);
     fprintf(fp, "</CellData>\n");
     fprintf(fp, "</ImageData>\n");
-    fprintf(fp, "<AppendedData encoding=\"raw\">\n");
-    fprintf(fp, "_");
-    fwrite((unsigned char *) &nxy, sizeof(long), 1, fp);
-
-    // start at 1 and end -1 -> ghost layer
-    for (y = 1; y < processHeight-1; y++) {
-        for (x = 1; x < processWidth-1; x++) {
-            float value = data[calcIndex(processWidth, x, y)];
-            fwrite((unsigned char *) &value, sizeof(float), 1, fp);
-        }
-    }
 
-    fprintf(fp, "\n</AppendedData>\n");
+    // start at halo and end -halo -> ghost layer
+    golVtkWriteCells(fp, data, words, halo, halo, processWidth - 2 * halo, processHeight - 2 * halo, vtkFormat, vtkCompress);
     fprintf(fp, "</VTKFile>\n");
     fclose(fp);
 }
@@ -52,12 +89,13 @@ void writeVTK2_parallel(long timestep, char prefix[1024], char vti_prefix[1024],
     FILE *fp = fopen(filename, "w");
 
     fprintf(fp, "<?xml version=\"1.0\"?>\n");
-    fprintf(fp, "<VTKFile type=\"PImageData\" version=\"0.1\" byte_order=\"LittleEndian\" header_type=\"UInt64\">\n");
+    fprintf(fp, "<VTKFile type=\"PImageData\" version=\"0.1\" byte_order=\"LittleEndian\" header_type=\"UInt64\"%s>\n",
+            golVtkCompressor(vtkCompress));
 
     fprintf(fp, "<PImageData WholeExtent=\"%d %d %d %d %d %d\" Origin=\"0 0 0\" Spacing=\"%le %le %le\">\n", 0,
                 w, 0, h, 0, 0, 1.0, 1.0, 0.0);
     fprintf(fp, "<PCellData Scalars=\"%s\">\n", vti_prefix);
-    fprintf(fp, "<PDataArray type=\"Float32\" Name=\"%s\" format=\"appended\" offset=\"0\"/>\n", vti_prefix);
+    fprintf(fp, "<PDataArray type=\"%s\" Name=\"%s\" format=\"appended\" offset=\"0\"/>\n", golVtkTypeName(vtkFormat), vti_prefix);
     fprintf(fp, "</PCellData>\n");
 
     for(int x = 0; x < px; x++){
@@ -82,268 +120,910 @@ void writeVTK2_parallel(long timestep, char prefix[1024], char vti_prefix[1024],
 }
 
 
-void show(double *currentfield, int w, int h) {
+/**
+ * Collective output: writes one .vti file of the whole gridWidth x gridHeight grid per timestep instead of one file per
+ * rank plus the .pvti index. Rank 0 writes the XML header and footer, every rank converts its interior cells into
+ * `buffer` and writes them in one MPI_File_write_all call through the subarray file view `fileType` of `cellType`
+ * elements. Only the byte-aligned formats (Float32, UInt8) without compression can be written this way.
+ */
+void writeVTKCollective(long timestep, const uint64_t *data, const char *prefix, int processWidth, int processHeight,
+                        int halo, int gridWidth, int gridHeight, MPI_Datatype cellType, MPI_Datatype fileType,
+                        unsigned char *buffer, MPI_Comm comm) {
+    char filename[2048];
+    char header[2048];
+    const char footer[] = "\n</AppendedData>\n</VTKFile>\n";
+    int words = calcWords(processWidth);
+    int tw = processWidth - 2 * halo;
+    int th = processHeight - 2 * halo;
+    uint64_t nxy = golVtkPayloadSize((uint64_t) gridWidth * gridHeight, vtkFormat);
+
+    snprintf(filename, sizeof(filename), "%s-%05ld%s", prefix, timestep, ".vti");
+    int headerLength = snprintf(header, sizeof(header),
+            "<?xml version=\"1.0\"?>\n"
+            "<VTKFile type=\"ImageData\" version=\"0.1\" byte_order=\"LittleEndian\" header_type=\"UInt64\">\n"
+            "<ImageData WholeExtent=\"0 %d 0 %d 0 0\" Origin=\"0 0 0\" Spacing=\"1.0 1.0 0.0\">\n"
+            "<Piece Extent=\"0 %d 0 %d 0 0\">\n"
+            "<CellData Scalars=\"%s\">\n"
+            "<DataArray type=\"%s\" Name=\"%s\" format=\"appended\" offset=\"0\"/>\n"
+            "</CellData>\n"
+            "</Piece>\n"
+            "</ImageData>\n"
+            "<AppendedData encoding=\"raw\">\n"
+            "_", gridWidth, gridHeight, gridWidth, gridHeight, prefix, golVtkTypeName(vtkFormat), prefix);
+    MPI_Offset dataOffset = headerLength + sizeof(uint64_t);
+
+    // start at halo and end -halo -> ghost layer
+    golVtkEncode(data, words, halo, halo, tw, th, vtkFormat, buffer);
+
+    MPI_File file;
+    MPI_File_open(comm, filename, MPI_MODE_CREATE | MPI_MODE_WRONLY, MPI_INFO_NULL, &file);
+    MPI_File_set_size(file, dataOffset + nxy + sizeof(footer) - 1);
+    if (rank == 0) {
+        MPI_File_write_at(file, 0, header, headerLength, MPI_CHAR, MPI_STATUS_IGNORE);
+        MPI_File_write_at(file, headerLength, &nxy, sizeof(uint64_t), MPI_BYTE, MPI_STATUS_IGNORE);
+        MPI_File_write_at(file, dataOffset + nxy, footer, sizeof(footer) - 1, MPI_CHAR, MPI_STATUS_IGNORE);
+    }
+    MPI_File_set_view(file, dataOffset, cellType, fileType, "native", MPI_INFO_NULL);
+    MPI_File_write_all(file, buffer, tw * th, cellType, MPI_STATUS_IGNORE);
+    MPI_File_close(&file);
+}
+
+// the piece of the grid a rank writes: its tile without the ghost layer
+typedef struct {
+    int processWidth, processHeight, halo;
+    int px, py;
+    int coordinates[2];
+} Piece;
+
+/**
+ * Writes the .vti file of this rank's piece, rank 0 also writes the .pvti index. Runs on the I/O thread of the snapshot
+ * ring, which only writes files and makes no MPI calls.
+ */
+void writePiece(long timestep, const uint64_t *field, void *context) {
+    Piece *piece = context;
+    int tw = piece->processWidth - 2 * piece->halo;
+    int th = piece->processHeight - 2 * piece->halo;
+    writeVTK2(timestep, field, "gol", piece->processWidth, piece->processHeight, piece->halo,
+              piece->coordinates[0] * tw, piece->coordinates[1] * th, piece->px, piece->coordinates);
+    if (rank == 0) writeVTK2_parallel(timestep, "golp", "gol", tw * piece->px, th * piece->py, piece->px, piece->py);
+}
+
+/**
+ * Checkpoint of one generation, written in parallel by every rank into its own file checkpoint-<rank>.gol that holds
+ * its tile, or collectively into the single file checkpoint.gol: the ranks of a process row (`rowComm`) gather their
+ * tiles at the first of them, which assembles the th grid rows of the row and writes them with one
+ * MPI_File_write_at_all call. Both can be restarted on any px x py. Returns the seconds it took.
+ */
+double writeCheckpoint(const uint64_t *field, int processWidth, int processHeight, int halo, int px, int py,
+                       int coordinates[2], long generation, int collective, MPI_Comm comm, MPI_Comm rowComm) {
+    double start = MPI_Wtime();
+    char fileName[2048];
+    int commSize;
+    MPI_Comm_size(comm, &commSize);
+    int words = calcWords(processWidth);
+    int tw = processWidth - 2 * halo;
+    int th = processHeight - 2 * halo;
+    GolCheckpoint header = {GOL_CHECKPOINT_MAGIC, (uint64_t) tw * px, (uint64_t) th * py, (uint64_t) coordinates[0] * tw,
+                            (uint64_t) coordinates[1] * th, tw, th, commSize, generation, seed, rule.birth,
+                            rule.survive};
+
+    if (!collective) {
+        golCheckpointFileName(fileName, sizeof(fileName), "checkpoint", commSize, rank);
+        golCheckpointWrite(fileName, &header, field, words, halo, halo);
+        return MPI_Wtime() - start;
+    }
+
+    int tileWords = calcWords(tw) * th;
+    int gridWords = calcWords(tw * px);
+    uint64_t *tile = malloc(tileWords * sizeof(uint64_t));
+    uint64_t *tiles = coordinates[0] == 0 ? malloc((size_t) tileWords * px * sizeof(uint64_t)) : NULL;
+    uint64_t *band = coordinates[0] == 0 ? calloc((size_t) gridWords * th, sizeof(uint64_t)) : NULL;
+    golCheckpointPack(field, words, halo, halo, tw, th, tile);
+    MPI_Gather(tile, tileWords, MPI_UINT64_T, tiles, tileWords, MPI_UINT64_T, 0, rowComm);
+    if (coordinates[0] == 0) {
+        for (int i = 0; i < px; i++) {
+            for (int r = 0; r < th; r++) {
+                const uint64_t *row = &tiles[(size_t) i * tileWords + calcIndex(calcWords(tw), 0, r)];
+                for (int c = 0; c < tw; c += WORD_BITS) {
+                    golStoreCells(&band[calcIndex(gridWords, 0, r)], i * tw + c, row[c / WORD_BITS],
+                                  tw - c < WORD_BITS ? tw - c : WORD_BITS);
+                }
+            }
+        }
+    }
+
+    // the whole grid is one region, the file is renamed once every rank has written its part
+    header.x0 = header.y0 = 0;
+    header.width = header.gridWidth;
+    header.height = header.gridHeight;
+    header.pieces = 1;
+    golCheckpointFileName(fileName, sizeof(fileName), "checkpoint", 1, 0);
+    char temporary[sizeof(fileName) + 4];
+    snprintf(temporary, sizeof(temporary), "%s.tmp", fileName);
+    MPI_File file;
+    MPI_File_open(comm, temporary, MPI_MODE_CREATE | MPI_MODE_WRONLY, MPI_INFO_NULL, &file);
+    if (rank == 0) MPI_File_write_at(file, 0, &header, sizeof(GolCheckpoint), MPI_BYTE, MPI_STATUS_IGNORE);
+    MPI_File_write_at_all(file, golCheckpointRowOffset(header.width, (uint64_t) coordinates[1] * th), band,
+                          coordinates[0] == 0 ? gridWords * th : 0, MPI_UINT64_T, MPI_STATUS_IGNORE);
+    MPI_File_close(&file);
+    MPI_Barrier(comm);
+    if (rank == 0 && rename(temporary, fileName) != 0) fprintf(stderr, "Could not write checkpoint %s\n", fileName);
+
+    free(tile);
+    free(tiles);
+    free(band);
+    return MPI_Wtime() - start;
+}
+
+void show(uint64_t *currentfield, int w, int h) {
     printf("\033[H");
     int x, y;
+    int words = calcWords(w);
     for (y = 0; y < h; y++) {
-        for (x = 0; x < w; x++) printf(currentfield[calcIndex(w, x, y)] ? "\033[07m  \033[m" : "  ");
+        for (x = 0; x < w; x++) printf(getCell(currentfield, words, x, y) ? "\033[07m  \033[m" : "  ");
         printf("\033[E");
         printf("\n");
     }
     fflush(stdout);
 }
 
-int countLivingsPeriodic(double *currentfield, int x, int y, int w, int h) {
-    int n = 0;
-    for (int y1 = y - 1; y1 <= y + 1; y1++) {
-        for (int x1 = x - 1; x1 <= x + 1; x1++) {
-            if (currentfield[calcIndex(w, (x1 + w) % w, (y1 + h) % h)]) {
-                n++;
+/**
+ * Computes the words from .. to-1 of the rows y0 .. y1-1 of the next generation. Whole words are computed, cells
+ * whose neighbourhood reaches past the valid region come out invalid and must lie outside the region the caller needs.
+ * If dirty is given, it is set when an interior cell (halo .. w-halo-1) of the computed words changed.
+ */
+void evolveRows(const uint64_t *currentfield, uint64_t *newfield, int w, int y0, int y1, int from, int to, int halo,
+                int *dirty) {
+    int words = calcWords(w);
+    int x0 = from * WORD_BITS > halo ? from * WORD_BITS : halo;
+    int x1 = to * WORD_BITS < w - halo ? to * WORD_BITS : w - halo;
+    for (int y = y0; y < y1 && from < to; y++) {
+        const uint64_t *row = &currentfield[calcIndex(words, 0, y)];
+        uint64_t *next = &newfield[calcIndex(words, 0, y)];
+        golEvolveRow(rowKernel, row - words, row, row + words, next, from, to, words);
+        if (dirty != NULL && !*dirty) *dirty = golCellsDiffer(row, next, x0, x1);
+    }
+}
+
+/**
+ * Temporal blocking: advances the cells x0 .. x1-1 of the rows y0 .. y1-1 by `generations` generations, reading the
+ * cells up to `generations` cells around them. The region is cut into L2-sized blocks which are advanced one after
+ * another, the cells outside the region are left untouched. If dirty is given, it is set when a cell of the region
+ * differs between the last two generations, so an oscillator whose period divides `generations` still counts as
+ * changing.
+ */
+void evolveBlocks(const uint64_t *currentfield, uint64_t *newfield, int w, int x0, int y0, int x1, int y1,
+                  int generations, int *dirty) {
+    if (x1 <= x0 || y1 <= y0) return;
+    int words = calcWords(w);
+
+    int blockWidth, blockHeight;
+    golBlockSize(x1 - x0, y1 - y0, generations, &blockWidth, &blockHeight);
+    int blockWords = calcWords(blockWidth + 2 * generations);
+    int blockRows = blockHeight + 2 * generations;
+    uint64_t *block = malloc(blockWords * blockRows * sizeof(uint64_t));
+    uint64_t *scratch = malloc(blockWords * blockRows * sizeof(uint64_t));
+
+    for (int by = y0; by < y1; by += blockHeight) {
+        int rows = by + blockHeight <= y1 ? blockHeight : y1 - by;
+        for (int bx = x0; bx < x1; bx += blockWidth) {
+            int cols = bx + blockWidth <= x1 ? blockWidth : x1 - bx;
+            int left = bx - generations;
+
+            // the block halo lies within the ghost layer, no wrap around
+            for (int r = 0; r < rows + 2 * generations; r++) {
+                golLoadRow(&block[calcIndex(blockWords, 0, r)], &currentfield[calcIndex(words, 0, by - generations + r)],
+                           left, blockWords, words);
+            }
+
+            const uint64_t *result = golAdvanceBlock(block, scratch, blockWords, rows + 2 * generations, generations,
+                                                     rowKernel);
+            // the other buffer holds the generation before, exact in the region as well
+            const uint64_t *previous = result == block ? scratch : block;
+
+            for (int r = generations; r < rows + generations; r++) {
+                const uint64_t *row = &result[calcIndex(blockWords, 0, r)];
+                uint64_t *next = &newfield[calcIndex(words, 0, by + r - generations)];
+                for (int x = bx; x < bx + cols; x += WORD_BITS) {
+                    int n = bx + cols - x < WORD_BITS ? bx + cols - x : WORD_BITS;
+                    golStoreCells(next, x, golLoadCells(row, x - left, blockWords), n);
+                }
+                if (dirty != NULL && !*dirty) {
+                    *dirty = golCellsDiffer(&previous[calcIndex(blockWords, 0, r)], row, generations, generations + cols);
+                }
             }
         }
     }
-    return n;
+    free(block);
+    free(scratch);
 }
 
+/**
+ * The core of a pass of `steps` generations: the cells x0 .. x1-1 of the rows y0 .. y1-1 only read interior cells,
+ * so they can be computed before the ghost layer has arrived. With a single generation the core is cut down to whole
+ * words, from .. to-1.
+ */
+void coreBounds(int w, int h, int halo, int steps, int *x0, int *y0, int *x1, int *y1, int *from, int *to) {
+    *x0 = halo + steps;
+    *y0 = halo + steps;
+    *x1 = w - halo - steps > *x0 ? w - halo - steps : *x0;
+    *y1 = h - halo - steps > *y0 ? h - halo - steps : *y0;
+    *from = calcWords(*x0);
+    *to = *x1 / WORD_BITS > *from ? *x1 / WORD_BITS : *from;
+}
 
-void evolve(int timestep, double *currentfield, double *newfield, int w, int h, MPI_Comm* comm) {
-
-        int x, y;
-
-        //printf("THREAD: %i with offset (%i | %i)\n", this_thread, offsetX, offsetY);
-        for (y = 1; y < h; y++) {
-            for (x = 1; x < w; x++) {
-                int n = countLivingsPeriodic(currentfield, x, y, w, h);
-                int index = calcIndex(w, x, y);
-                if (currentfield[index]) n--;
-                newfield[index] = (n == 3 || (n == 2 && currentfield[index]));
-
-                /*
-                printf(" INDEX: %d %i(%d|%d) = (%d + %d | %d + %d) \t\t n = %d \talive=%f\n",
-                        index,
-                        this_thread,
-                        x + offsetX,
-                        y + offsetY,
-                        x,
-                       offsetX,
-                       y,
-                       offsetY,
-                       n,
-                       currentfield[index]);
-                */
-            }  
+/**
+ * Activity tracking for the core of single-generation passes: the core words are cut into tiles of tileWords words x
+ * tileRows rows. `before` marks the tiles that changed in the last generation, `now` receives the marks of this one.
+ */
+typedef struct {
+    int tileWords, tileRows, tilesX, tilesY;
+    unsigned char *before, *now;
+} Activity;
+
+/**
+ * Returns 1 if the activity tile (ax, ay) or one of its eight neighbours changed. Tiles next to the core border always
+ * count as changed, the frame around the core is computed every generation.
+ */
+int neighbourhoodChanged(const Activity *activity, int ax, int ay) {
+    if (ax == 0 || ay == 0 || ax == activity->tilesX - 1 || ay == activity->tilesY - 1) return 1;
+    for (int dy = -1; dy <= 1; dy++) {
+        for (int dx = -1; dx <= 1; dx++) {
+            if (activity->before[calcIndex(activity->tilesX, ax + dx, ay + dy)]) return 1;
+        }
     }
+    return 0;
 }
 
-void fillRandom(double *currentField, int w, int h) {
-    for (int i = 0; i < h * w; i++) {
-        currentField[i] = (rand() < RAND_MAX / 10) ? 1 : 0; ///< init domain randomly
+/**
+ * Computes the core of a pass (see coreBounds()), the rows are cut into bands that the rank's threads share. While a
+ * halo exchange is in flight the master thread, the only one that calls MPI, tests the given requests between its
+ * bands, so the MPI library keeps progressing the messages.
+ */
+void evolveInner(const uint64_t *currentfield, uint64_t *newfield, int w, int h, int halo, int steps,
+                 MPI_Request *requests, int count, int *dirty, Activity *activity) {
+    int x0, y0, x1, y1, from, to;
+    coreBounds(w, h, halo, steps, &x0, &y0, &x1, &y1, &from, &to);
+    int changed = 0;
+
+    if (steps == 1 && activity != NULL) {
+        // sparse evolution: tiles whose neighbourhood did not change are skipped, newfield still holds the generation
+        // before, which equals the current one there; runs of active tiles are computed in one go
+        int words = calcWords(w);
+#pragma omp parallel num_threads(threadCount) reduction(|:changed)
+        {
+            double begin = omp_get_wtime();
+            int arrived = requests == NULL || omp_get_thread_num() != 0;
+#pragma omp for schedule(dynamic) nowait
+            for (int ay = 0; ay < activity->tilesY; ay++) {
+                int y = y0 + ay * activity->tileRows;
+                int end = y + activity->tileRows < y1 ? y + activity->tileRows : y1;
+                for (int ax = 0; ax < activity->tilesX; ) {
+                    if (!neighbourhoodChanged(activity, ax, ay)) {
+                        activity->now[calcIndex(activity->tilesX, ax, ay)] = 0;
+                        ax++;
+                        continue;
+                    }
+                    int last = ax;
+                    while (last + 1 < activity->tilesX && neighbourhoodChanged(activity, last + 1, ay)) last++;
+                    int wordFrom = from + ax * activity->tileWords;
+                    int wordTo = from + (last + 1) * activity->tileWords < to ? from + (last + 1) * activity->tileWords : to;
+                    evolveRows(currentfield, newfield, w, y, end, wordFrom, wordTo, halo, NULL);
+
+                    // the rows are still in cache, compare them tile by tile
+                    for (; ax <= last; ax++) {
+                        int tileFrom = from + ax * activity->tileWords;
+                        int tileTo = tileFrom + activity->tileWords < to ? tileFrom + activity->tileWords : to;
+                        int tileChanged = 0;
+                        for (int r = y; r < end && !tileChanged; r++) {
+                            tileChanged = golCellsDiffer(&currentfield[calcIndex(words, 0, r)],
+                                                         &newfield[calcIndex(words, 0, r)],
+                                                         tileFrom * WORD_BITS, tileTo * WORD_BITS);
+                        }
+                        activity->now[calcIndex(activity->tilesX, ax, ay)] = tileChanged;
+                        changed |= tileChanged;
+                    }
+                }
+                if (!arrived) MPI_Testall(count, requests, &arrived, MPI_STATUSES_IGNORE);
+            }
+            threadTimes[omp_get_thread_num()].seconds[GOL_PHASE_EVOLVE] += omp_get_wtime() - begin;
+        }
+        if (dirty != NULL && changed) *dirty = 1;
+        unsigned char *temp = activity->before;
+        activity->before = activity->now;
+        activity->now = temp;
+        return;
     }
+
+    int band = POLL_ROWS;
+    if (steps > 1) {
+        int blockWidth;
+        golBlockSize(x1 - x0, y1 - y0, steps, &blockWidth, &band);
+    }
+    // a subdomain no wider or higher than twice halo + steps has no core, the frame computes everything
+    if (band < 1) band = 1;
+    // enough bands for every thread, at the price of more block halo rows
+    while ((y1 - y0 + band - 1) / band < UNITS_PER_THREAD * threadCount && band > steps) band = (band + 1) / 2;
+    int bands = (y1 - y0 + band - 1) / band;
+
+#pragma omp parallel num_threads(threadCount) reduction(|:changed)
+    {
+        double begin = omp_get_wtime();
+        int arrived = requests == NULL || omp_get_thread_num() != 0;
+        int *track = dirty != NULL ? &changed : NULL;
+#pragma omp for schedule(dynamic) nowait
+        for (int b = 0; b < bands; b++) {
+            int y = y0 + b * band;
+            int end = y + band < y1 ? y + band : y1;
+            if (steps == 1) evolveRows(currentfield, newfield, w, y, end, from, to, halo, track);
+            else evolveBlocks(currentfield, newfield, w, x0, y, x1, end, steps, track);
+            if (!arrived) MPI_Testall(count, requests, &arrived, MPI_STATUSES_IGNORE);
+        }
+        threadTimes[omp_get_thread_num()].seconds[GOL_PHASE_EVOLVE] += omp_get_wtime() - begin;
+    }
+    if (dirty != NULL && changed) *dirty = 1;
 }
 
-void readUntilNewLine(FILE *pFile) {
-    int readCharacter;
-    do {
-        readCharacter = fgetc(pFile);
-    } while (readCharacter != '\n' && readCharacter != EOF);
+/**
+ * Computes the rest of a pass once the ghost layer is complete: the frame between `margin` cells from the subdomain
+ * edge and the core. The frame is cut into bands of rows, each band holds full rows above and below the core and the
+ * left and right strips beside it. Change tracking (dirty) is only exact for the last pass of a halo period, where
+ * margin == halo.
+ */
+void evolveOuter(const uint64_t *currentfield, uint64_t *newfield, int w, int h, int halo, int margin, int steps,
+                 int *dirty) {
+    int x0, y0, x1, y1, from, to;
+    coreBounds(w, h, halo, steps, &x0, &y0, &x1, &y1, &from, &to);
+    int words = calcWords(w);
+    int bands = (h - 2 * margin + POLL_ROWS - 1) / POLL_ROWS;
+    int changed = 0;
+
+#pragma omp parallel num_threads(threadCount) reduction(|:changed)
+    {
+        double begin = omp_get_wtime();
+#pragma omp for schedule(dynamic) nowait
+        for (int b = 0; b < bands; b++) {
+            int *track = dirty != NULL ? &changed : NULL;
+            int ya = margin + b * POLL_ROWS;
+            int yb = ya + POLL_ROWS < h - margin ? ya + POLL_ROWS : h - margin;
+            // rows of the band above the core, beside it and below it
+            int above = yb < y0 ? yb : y0;
+            int besideFrom = ya > y0 ? ya : y0;
+            int besideTo = yb < y1 ? yb : y1;
+            int below = ya > y1 ? ya : y1;
+            if (steps == 1) {
+                evolveRows(currentfield, newfield, w, ya, above, 0, words, halo, track);
+                evolveRows(currentfield, newfield, w, below, yb, 0, words, halo, track);
+                evolveRows(currentfield, newfield, w, besideFrom, besideTo, 0, from, halo, track);
+                evolveRows(currentfield, newfield, w, besideFrom, besideTo, from < to ? to : from, words, halo, track);
+            } else {
+                evolveBlocks(currentfield, newfield, w, margin, ya, w - margin, above, steps, track);
+                evolveBlocks(currentfield, newfield, w, margin, below, w - margin, yb, steps, track);
+                evolveBlocks(currentfield, newfield, w, margin, besideFrom, x0, besideTo, steps, track);
+                evolveBlocks(currentfield, newfield, w, x1, besideFrom, w - margin, besideTo, steps, track);
+            }
+        }
+        threadTimes[omp_get_thread_num()].seconds[GOL_PHASE_EVOLVE] += omp_get_wtime() - begin;
+    }
+    if (dirty != NULL && changed) *dirty = 1;
 }
 
-void setCellState(double *currentField, int alive, int *index, int *count) {
-    //printf("Filling %d characters at index %d with %d\n", (*count), (*index), alive);
-    while((*count) > 0) {
-        currentField[(*index)] = (double)alive;
-        //printf("Setting %d to %d\n", (*index), alive);
-        (*index)++;
-        (*count)--;
+/**
+ * Fills this rank's tile randomly, the threads share its rows. Every cell follows from the seed and its global
+ * coordinates, so the grid is the same for every px x py; the ghost layer is left to the first halo exchange.
+ */
+void fillRandom(uint64_t *currentField, int w, int halo, int tw, int th, int coordinates[2]) {
+#pragma omp parallel for num_threads(threadCount) schedule(static)
+    for (int y = 0; y < th; y++) {
+        golRandomFill(currentField, calcWords(w), halo, halo + y, coordinates[0] * tw, coordinates[1] * th + y, tw, 1,
+                      seed);
     }
 }
 
-void fillFromFile(double *currentField, int w, char *fileName) {
-    FILE *file = fopen(fileName, "r");
+/**
+ * Copies the cells x .. x+cols-1 of the rows y .. y+rows-1 into a contiguous buffer, every row starts at a new word.
+ * Strips next to the ghost layer are not addressable by an MPI datatype on packed rows, so all of them travel packed.
+ */
+void packBlock(const uint64_t *field, int w, int x, int y, int cols, int rows, uint64_t *buffer) {
+    int words = calcWords(w);
+    int stride = calcWords(cols);
+    for (int r = 0; r < rows; r++) {
+        golLoadRow(&buffer[calcIndex(stride, 0, r)], &field[calcIndex(words, 0, y + r)], x, stride, words);
+    }
+}
 
-    //Files start with a 2 line header (comment + size/rule info)
-    readUntilNewLine(file);
-    readUntilNewLine(file);
+void unpackBlock(uint64_t *field, int w, int x, int y, int cols, int rows, const uint64_t *buffer) {
+    int words = calcWords(w);
+    int stride = calcWords(cols);
+    for (int r = 0; r < rows; r++) {
+        for (int j = 0; j < stride; j++) {
+            int n = cols - j * WORD_BITS < WORD_BITS ? cols - j * WORD_BITS : WORD_BITS;
+            golStoreCells(&field[calcIndex(words, 0, y + r)], x + j * WORD_BITS, buffer[calcIndex(stride, j, r)], n);
+        }
+    }
+}
 
-    int index = 0;
-    int count = 0;
+/**
+ * Start and length of a halo strip along one axis of a subdomain with `size` cells (ghost layer included).
+ * Direction -1/0/1 selects the low edge, the interior or the high edge; inner strips are sent, ghost strips received.
+ */
+void haloStrip(int size, int halo, int direction, int ghost, int *start, int *length) {
+    *length = direction == 0 ? size - 2 * halo : halo;
+    if (direction < 0) *start = ghost ? 0 : halo;
+    else if (direction > 0) *start = ghost ? size - halo : size - 2 * halo;
+    else *start = halo;
+}
 
+/**
+ * Loads this rank's tile of the memory-mapped RLE pattern without any rank holding the whole grid: every rank scans its
+ * share of the chunks, the scan results are combined with MPI_Allreduce, then every rank decodes only the chunks that
+ * cover its rows and keeps the cells of its columns. The threads of a rank share its chunks.
+ */
+void fillFromFile(uint64_t *currentField, int w, int halo, int tw, int th, int coordinates[2], GolRle *rle,
+                  MPI_Comm comm) {
+    int commSize;
+    MPI_Comm_size(comm, &commSize);
+    int chunks = golRleChunks(rle);
+    int first = (long) chunks * rank / commSize;
+    int last = (long) chunks * (rank + 1) / commSize;
+
+#pragma omp parallel for num_threads(threadCount) schedule(dynamic)
+    for (int chunk = first; chunk < last; chunk++) {
+        golRleScan(rle, chunk);
+    }
+    MPI_Allreduce(MPI_IN_PLACE, golRleCounts(rle), 2 * chunks, MPI_LONG, MPI_SUM, comm);
+    golRleIndex(rle);
+
+    int failed = 0;
+#pragma omp parallel for num_threads(threadCount) schedule(dynamic) reduction(|:failed)
+    for (int chunk = 0; chunk < chunks; chunk++) {
+        failed |= golRleDecode(rle, chunk, currentField, calcWords(w), halo, halo, coordinates[0] * tw,
+                               coordinates[1] * th, tw, th) != 0;
+    }
+    if (failed) MPI_Abort(comm, 1);
+}
 
-    int readCharacter = fgetc(file);
-    while(readCharacter != EOF) {
-        if(readCharacter >= '0' && readCharacter <= '9') {
-            count = count * 10 + (readCharacter - '0');
-        } else if(readCharacter == 'b' || readCharacter == 'o') {
-            int alive = readCharacter == 'o';
-            if(count == 0) {
-                //Direct color switch without preceding number
-                count = 1;
-            }
-            setCellState(currentField, alive, &index, &count);
-        } else if(readCharacter == '$' || readCharacter == '!') {
-            //End of line, or end of file -> Pad until end of line with empty cells
-            if((index % w) != 0) {
-                count = (w - (index % w));
-            }
-            setCellState(currentField, 0, &index, &count);
-        } else if(readCharacter == '#') {
-            readUntilNewLine(file);
-        } else if(readCharacter == '\n') {
+void game(MPI_Comm* comm, long timeSteps, int tw, int th, int px, int py, int halo, int temporal, int check,
+          int activitySize, int collective, int stride, int checkpointEvery, const GolCheckpoint *restart,
+          const char *timingFile) {
+    // the ghost layer is `halo` cells deep: one exchange, then `halo` generations on a shrinking valid region
+    int h,w;
+    h = th+2*halo;
+    w = tw+2*halo;
+    int words = calcWords(w);
+
+    // one packed strip per neighbour direction, the diagonal ones carry the corner cells
+    uint64_t *sendBuffer[DIRECTIONS];
+    uint64_t *recvBuffer[DIRECTIONS];
+    int stripWords[DIRECTIONS];
+    for (int d = 0; d < DIRECTIONS; d++) {
+        int x, y, cols, rows;
+        haloStrip(w, halo, directions[d][0], 0, &x, &cols);
+        haloStrip(h, halo, directions[d][1], 0, &y, &rows);
+        stripWords[d] = rows * calcWords(cols);
+        sendBuffer[d] = calloc(stripWords[d], sizeof(uint64_t));
+        recvBuffer[d] = calloc(stripWords[d], sizeof(uint64_t));
+    }
 
-        }
-        else {
-            printf("Invalid character read: %d", readCharacter);
-            exit(1);
-        }
 
-        readCharacter = fgetc(file);
+    uint64_t *currentfield = calloc(words * h, sizeof(uint64_t));
+    uint64_t *newfield = calloc(words * h, sizeof(uint64_t));
+
+
+    // activity tiles cover the core of single-generation passes, every tile starts out marked as changed
+    Activity *activity = NULL;
+    int coreX0, coreY0, coreX1, coreY1, coreFrom, coreTo;
+    coreBounds(w, h, halo, 1, &coreX0, &coreY0, &coreX1, &coreY1, &coreFrom, &coreTo);
+    if (activitySize > 0 && temporal == 1 && coreFrom < coreTo && coreY0 < coreY1) {
+        activity = malloc(sizeof(Activity));
+        activity->tileWords = calcWords(activitySize);
+        activity->tileRows = activitySize;
+        activity->tilesX = (coreTo - coreFrom + activity->tileWords - 1) / activity->tileWords;
+        activity->tilesY = (coreY1 - coreY0 + activity->tileRows - 1) / activity->tileRows;
+        activity->before = malloc(activity->tilesX * activity->tilesY);
+        activity->now = malloc(activity->tilesX * activity->tilesY);
+        memset(activity->before, 1, activity->tilesX * activity->tilesY);
     }
-}
 
-void filling(double *currentField, int w, int h, char *fileName) {
-    if (access(fileName, R_OK) == 0) {
-        //File exists
-        fillFromFile(currentField, w, fileName);
+    //-> arrays of request/status for async communication
+    MPI_Request request[2 * DIRECTIONS];
+    MPI_Status status[2 * DIRECTIONS];
+
+    // the halo exchange is set up once: a graph topology over the eight neighbours and persistent requests on the
+    // fixed strip buffers, every exchange only packs and starts them.
+    // A message sent towards direction d arrives from direction 7-d, the tag tells the directions apart when several
+    // directions lead to the same rank
+    // every edge has the same weight; MPI_UNWEIGHTED is a zero-sized sentinel the compiler warns about reading from
+    int weights[DIRECTIONS] = {1, 1, 1, 1, 1, 1, 1, 1};
+    MPI_Comm haloComm;
+    MPI_Dist_graph_create_adjacent(*comm, DIRECTIONS, neighbours, weights, DIRECTIONS, neighbours, weights,
+                                   MPI_INFO_NULL, 0, &haloComm);
+    for (int d = 0; d < DIRECTIONS; d++) {
+        MPI_Recv_init(recvBuffer[d], stripWords[d], MPI_UINT64_T, neighbours[d], DIRECTIONS - 1 - d, haloComm, request + d);
+        MPI_Send_init(sendBuffer[d], stripWords[d], MPI_UINT64_T, neighbours[d], d, haloComm, request + DIRECTIONS + d);
+    }
+    long exchanges = 0;
+    double overlapped = 0, waited = 0;
+    int commSize;
+    MPI_Comm_size(*comm, &commSize);
+
+    int coordinates[2];
+    MPI_Cart_coords(*comm, rank, 2, coordinates);
+
+    // a restart reads the tile from the checkpoint files it overlaps, whatever decomposition wrote them, and goes on
+    // from their generation up to timeSteps
+    long start = 0;
+    if (restart != NULL) {
+        if (golCheckpointLoad("checkpoint", restart, currentfield, words, halo, halo, coordinates[0] * tw,
+                              coordinates[1] * th, tw, th) != 0) {
+            MPI_Abort(*comm, 1);
+        }
+        start = restart->generation;
     } else {
-        //File does not exist
-        fillRandom(currentField, w, h);
+        // every rank decodes its own tile of file.rle, without one the field is filled randomly
+        GolRle *rle = golRleOpen("file.rle", commSize * threadCount * UNITS_PER_THREAD);
+        if (rle != NULL) {
+            fillFromFile(currentfield, w, halo, tw, th, coordinates, rle, *comm);
+            golRleClose(rle);
+        } else {
+            fillRandom(currentfield, w, halo, tw, th, coordinates);
+        }
+    }
+    // collective checkpoints gather the tiles of a process row at its first rank
+    MPI_Comm rowComm = MPI_COMM_NULL;
+    if (checkpointEvery > 0 && collective) MPI_Comm_split(*comm, coordinates[1], coordinates[0], &rowComm);
+    int checkpoints = 0;
+    double checkpointTime = 0;
+
+    // collective output: the file view of this rank's tile within the whole grid, rows are y, columns x
+    MPI_Datatype cellType = vtkFormat == GOL_VTK_UINT8 ? MPI_UNSIGNED_CHAR : MPI_FLOAT;
+    MPI_Datatype fileType = MPI_DATATYPE_NULL;
+    unsigned char *outputBuffer = NULL;
+    double outputTime = 0;
+    if (collective) {
+        int sizes[2] = {th * py, tw * px};
+        int subsizes[2] = {th, tw};
+        int starts[2] = {coordinates[1] * th, coordinates[0] * tw};
+        MPI_Type_create_subarray(2, sizes, subsizes, starts, MPI_ORDER_C, cellType, &fileType);
+        MPI_Type_commit(&fileType);
+        outputBuffer = malloc(golVtkPayloadSize((uint64_t) tw * th, vtkFormat));
     }
-}
 
-void game(MPI_Comm* comm, long timeSteps, int tw, int th, int px, int py) {
-    int h,w;
-    h = th+2;
-    w = tw+2;
-
-    int size_arrays[2] = {h, w};
-    int size_subarrays_vert[2] = {h, 1};
-    int size_subarrays_hori[2] = {1, w};
-
-    MPI_Datatype ghTop;
-    MPI_Datatype ghBottom;
-    MPI_Datatype ghRight;
-    MPI_Datatype ghLeft;
-
-    MPI_Datatype innerTop;
-    MPI_Datatype innerBottom;
-    MPI_Datatype innerRight;
-    MPI_Datatype innerLeft;
-
-    int n = 2;
-    int start_indices[2] = {0, 0};
-    MPI_Type_create_subarray(n, size_arrays, size_subarrays_vert, start_indices, MPI_ORDER_C, MPI_DOUBLE, &ghLeft);
-    start_indices[1] = 1;
-    MPI_Type_create_subarray(n, size_arrays, size_subarrays_vert, start_indices, MPI_ORDER_C, MPI_DOUBLE, &innerLeft);
-    start_indices[1] = w - 1;
-    MPI_Type_create_subarray(n, size_arrays, size_subarrays_vert, start_indices, MPI_ORDER_C, MPI_DOUBLE, &ghRight);
-    start_indices[1] = w - 2;
-    MPI_Type_create_subarray(n, size_arrays, size_subarrays_vert, start_indices, MPI_ORDER_C, MPI_DOUBLE, &innerRight);
-
-    MPI_Type_commit(&ghLeft);
-    MPI_Type_commit(&innerLeft);
-    MPI_Type_commit(&ghRight);
-    MPI_Type_commit(&innerRight);
-
-    start_indices[0] = 0;
-    start_indices[1] = 0;
-    MPI_Type_create_subarray(n, size_arrays, size_subarrays_hori, start_indices, MPI_ORDER_C, MPI_DOUBLE, &ghTop);
-    start_indices[0] = 1;
-    MPI_Type_create_subarray(n, size_arrays, size_subarrays_hori, start_indices, MPI_ORDER_C, MPI_DOUBLE, &innerTop);
-    start_indices[0] = h - 1;
-    MPI_Type_create_subarray(n, size_arrays, size_subarrays_hori, start_indices, MPI_ORDER_C, MPI_DOUBLE, &ghBottom);
-    start_indices[0] = h - 2;
-    MPI_Type_create_subarray(n, size_arrays, size_subarrays_hori, start_indices, MPI_ORDER_C, MPI_DOUBLE, &innerBottom);
-
-
-    MPI_Type_commit(&ghTop);
-    MPI_Type_commit(&innerTop);
-    MPI_Type_commit(&ghBottom);
-    MPI_Type_commit(&innerBottom);
-
-
-    // if(rank == 0){
-    //     // load file / random init in one process
-    //     int w, h;
-    //     w = tw * px;
-    //     h = th * py;
-    //     double *loadedfield = calloc(w * h, sizeof(double));
-    //     filling(loadedfield, w, h, "file.rle");
-
-    //     free(loadedfield);
-    // }
-    // else{
-    //     MPI_Status status;
-    //     MPI_Recv(currentfield, w * h, MPI_DOUBLE, 0, rank, *comm, status);
-    // }
-    
-
-    double *currentfield = calloc(w * h, sizeof(double));
-    double *newfield = calloc(w * h, sizeof(double));
-
-    //Also fills ghost-layer, will be overwritten
-    fillRandom(currentfield, w, h);
+    // output every `stride`-th pass: one file per rank is copied into the snapshot ring and written by the I/O thread
+    // while the rank goes on. MPI-IO stays on the master thread, MPI_THREAD_FUNNELED allows no MPI calls from another
+    // thread
+    Piece piece = {w, h, halo, px, py, {coordinates[0], coordinates[1]}};
+    GolSnapshots *snapshots = NULL;
+#ifndef performance
+    if (stride > 0 && !collective) {
+        snapshots = golSnapshotsCreate(SNAPSHOT_BUFFERS, words * h * sizeof(uint64_t), writePiece, &piece);
+    }
+#endif
+    long passes = 0;
 
+    // the rank's phases are booked on its first thread; the parallel regions' wall time minus a thread's own evolve
+    // work is the time it waited for the others
+    if (posix_memalign((void **) &threadTimes, sizeof(GolTimes), threadCount * sizeof(GolTimes)) != 0) {
+        fprintf(stderr, "Could not allocate the timing buffers\n");
+        MPI_Abort(*comm, 1);
+    }
+    memset(threadTimes, 0, threadCount * sizeof(GolTimes));
+    double evolveTime = 0, reduceTime = 0, swapTime = 0;
+    long computed = 0;
 
-    //-> arrays of request/status for async communication
-    MPI_Request request[8];
-    MPI_Status status[8];
+    // steady-state check: the last pass of every `check`-th halo period tracks whether an interior cell changed, the
+    // flags are reduced without blocking and the result is picked up during the next halo exchange
+    int dirty = 0, sendDirty = 0, globalDirty = 1;
+    int steady = 0;
+    MPI_Request checkRequest = MPI_REQUEST_NULL;
 
     long t;
-    for (t = 0; t < timeSteps; t++) {
-        MPI_Isend(currentfield, 1, innerLeft, left_neighbor, 1, *comm, request + 0);
-        MPI_Irecv(currentfield, 1, ghRight, right_neighbor, 1, *comm, request + 1);
-        MPI_Irecv(currentfield, 1, ghLeft, left_neighbor, 2, *comm, request + 2);
-        MPI_Isend(currentfield, 1, innerRight, right_neighbor, 2, *comm, request + 3);
+    double loopStart = MPI_Wtime();
+    for (t = start; t < timeSteps && !steady; t += halo) {
+        int generations = timeSteps - t < halo ? timeSteps - t : halo;
+        int checking = check > 0 && (t / halo) % check == 0;
+
+        for (int d = 0; d < DIRECTIONS; d++) {
+            int x, y, cols, rows;
+            haloStrip(w, halo, directions[d][0], 0, &x, &cols);
+            haloStrip(h, halo, directions[d][1], 0, &y, &rows);
+            packBlock(currentfield, w, x, y, cols, rows, sendBuffer[d]);
+        }
+        MPI_Startall(2 * DIRECTIONS, request);
+        double posted = MPI_Wtime();
+        exchanges++;
 
-        MPI_Isend(currentfield, 1, innerTop, top_neighbor, 3, *comm, request + 4);
-        MPI_Irecv(currentfield, 1, ghBottom, bottom_neighbor, 3, *comm, request + 5);
-        MPI_Irecv(currentfield, 1, ghTop, top_neighbor, 4, *comm, request + 6);
-        MPI_Isend(currentfield, 1, innerBottom, bottom_neighbor, 4, *comm, request + 7);
+        // `temporal` generations per pass, every pass only computes the region the remaining generations still need
+        for (int done = 0; done < generations; ) {
+            int steps = generations - done < temporal ? generations - done : temporal;
+            int margin = halo - (generations - done - steps);
 
-        MPI_Waitall(8, request, status);
+#ifndef performance
+            double outputStart = MPI_Wtime();
+            if (stride > 0 && passes % stride == 0) {
+                if (collective) {
+                    writeVTKCollective(t + done, currentfield, "gol", w, h, halo, tw*px, th*py, cellType, fileType, outputBuffer, *comm);
+                } else {
+                    golSnapshot(snapshots, t + done, currentfield);
+                }
+            }
+            passes++;
+            outputTime += MPI_Wtime() - outputStart;
+            if(rank == 0) {
+                printf("%ld timestep\n", t + done);
+            }
+#endif
 
-        evolve(t, currentfield, newfield, w, h, comm);
+            dirty = 0;
+            int *track = checking && done + steps == generations ? &dirty : NULL;
+
+            // the core of the first pass needs no ghost cells, it is computed while the exchange is in flight
+            double evolveStart = MPI_Wtime();
+            evolveInner(currentfield, newfield, w, h, halo, steps, done == 0 ? request : NULL, 2 * DIRECTIONS, track,
+                        activity);
+            evolveTime += MPI_Wtime() - evolveStart;
+
+            if (done == 0) {
+                double waiting = MPI_Wtime();
+                MPI_Waitall(2 * DIRECTIONS, request, status);
+                double arrived = MPI_Wtime();
+                overlapped += waiting - posted;
+                waited += arrived - waiting;
+
+                for (int d = 0; d < DIRECTIONS; d++) {
+                    int x, y, cols, rows;
+                    haloStrip(w, halo, directions[d][0], 1, &x, &cols);
+                    haloStrip(h, halo, directions[d][1], 1, &y, &rows);
+                    unpackBlock(currentfield, w, x, y, cols, rows, recvBuffer[d]);
+                }
+#ifndef performance
+                // the exchange completed at `arrived` at the latest, everything before `waiting` was hidden by work
+                if(rank == 0) {
+                    printf("%ld exchange: %.3f ms overlapped, %.3f ms waiting (%.0f%% hidden)\n", t,
+                           (waiting - posted) * 1e3, (arrived - waiting) * 1e3,
+                           100.0 * (waiting - posted) / (arrived - posted));
+                }
+#endif
+
+                // the check posted in the previous halo period had this whole exchange to complete
+                if (checkRequest != MPI_REQUEST_NULL) {
+                    double reduceStart = MPI_Wtime();
+                    MPI_Wait(&checkRequest, MPI_STATUS_IGNORE);
+                    reduceTime += MPI_Wtime() - reduceStart;
+                    if (!globalDirty) {
+                        steady = 1;
+                        break;
+                    }
+                }
+            }
+
+            evolveStart = MPI_Wtime();
+            evolveOuter(currentfield, newfield, w, h, halo, margin, steps, track);
+            evolveTime += MPI_Wtime() - evolveStart;
+            done += steps;
+
+            // with temporal blocking the check compares generations `temporal` apart, so a cycle of that period also
+            // ends the game
+            if (track != NULL) {
+                double reduceStart = MPI_Wtime();
+                sendDirty = dirty;
+                MPI_Iallreduce(&sendDirty, &globalDirty, 1, MPI_INT, MPI_LOR, *comm, &checkRequest);
+                reduceTime += MPI_Wtime() - reduceStart;
+            }
+            double swapStart = MPI_Wtime();
+            //SWAP
+            uint64_t *temp = currentfield;
+            currentfield = newfield;
+            newfield = temp;
+            swapTime += MPI_Wtime() - swapStart;
+            computed += steps;
+        }
 
+        // every `checkpointEvery`-th halo period the interior of the new generation is saved
+        if (checkpointEvery > 0 && !steady && ((t - start) / halo + 1) % checkpointEvery == 0) {
+            double seconds = writeCheckpoint(currentfield, w, h, halo, px, py, coordinates, t + generations, collective,
+                                             *comm, rowComm);
+            checkpoints++;
+            checkpointTime += seconds;
 #ifndef performance
-        int coordinates[2];
-        MPI_Cart_coords(*comm, rank, 2, coordinates);
-        writeVTK2(t, currentfield, "gol", w, h, coordinates[0]*(w-2), coordinates[1]*(h - 2), px, coordinates);
-        if(rank == 0) {
-            writeVTK2_parallel(t, "golp", "gol", tw*px, th*py, px, py);
-            printf("%ld timestep\n", t);
+            if (rank == 0) printf("%ld checkpoint: %.3f ms\n", t + generations, seconds * 1e3);
+#endif
         }
+    }
 
+    double reduceStart = MPI_Wtime();
+    MPI_Wait(&checkRequest, MPI_STATUS_IGNORE);
+    reduceTime += MPI_Wtime() - reduceStart;
+    double loopTime = MPI_Wtime() - loopStart;
+
+    // the frames still queued are written before the time is taken, only the stalls counted in the loop
+    if (snapshots != NULL) golSnapshotsFree(snapshots);
+
+    double times[4] = {overlapped, waited, outputTime, checkpointTime};
+    double totalTimes[4];
+    MPI_Reduce(times, totalTimes, 4, MPI_DOUBLE, MPI_SUM, 0, *comm);
+
+    // per-phase report: the threads of all ranks at rank 0, the run takes as long as its slowest rank
+    double *phases = threadTimes[0].seconds;
+    phases[GOL_PHASE_HALO] = waited;
+    phases[GOL_PHASE_ALLREDUCE] = reduceTime;
+    phases[GOL_PHASE_SWAP] = swapTime;
+    phases[GOL_PHASE_OUTPUT] = outputTime;
+    phases[GOL_PHASE_CHECKPOINT] = checkpointTime;
+    for (int i = 0; i < threadCount; i++) {
+        threadTimes[i].seconds[GOL_PHASE_BARRIER] = evolveTime - threadTimes[i].seconds[GOL_PHASE_EVOLVE];
+    }
+    GolRun run = {"mpi", (long) tw * px, (long) th * py, computed, commSize, threadCount, 0};
+    GolTimes *allTimes = rank == 0 ? malloc(commSize * threadCount * sizeof(GolTimes)) : NULL;
+    MPI_Reduce(&loopTime, &run.seconds, 1, MPI_DOUBLE, MPI_MAX, 0, *comm);
+    MPI_Gather(threadTimes, threadCount * sizeof(GolTimes) / sizeof(double), MPI_DOUBLE, allTimes,
+               threadCount * sizeof(GolTimes) / sizeof(double), MPI_DOUBLE, 0, *comm);
+    if (rank == 0) {
+#ifndef performance
+        printf("Throughput: %.3g cells/s, imbalance: %.2f\n", golCellsPerSecond(&run), golImbalance(&run, allTimes));
 #endif
+        if (timingFile != NULL) golTimingWrite(timingFile, &run, allTimes);
+        free(allTimes);
+    }
+    free(threadTimes);
 
-        int equal = 1;
-        for(int i = 0; i < w*h; i++){
-            if(currentfield[i] != newfield[i]){
-                equal = 0;
-                break;
-            }
-        }
-        int reduced_equal;
-        MPI_Allreduce(&equal, &reduced_equal, 1, MPI_INT, MPI_LAND, *comm);
-        if(reduced_equal){
-            break;
+#ifndef performance
+    if (rank == 0) {
+        printf("Halo exchanges: %ld, messages sent per rank: %ld\n", exchanges, exchanges * DIRECTIONS);
+        printf("Communication hidden: %.0f%% (%.3f s overlapped, %.3f s waiting per rank)\n",
+               100.0 * totalTimes[0] / (totalTimes[0] + totalTimes[1]), totalTimes[0] / commSize, totalTimes[1] / commSize);
+        printf("Output (%s): %.3f s per rank\n", collective ? "mpiio" : "files", totalTimes[2] / commSize);
+        if (checkpoints > 0) {
+            printf("Checkpoints (%s): %d of %.1f KiB, %.3f ms each per rank\n", collective ? "mpiio" : "files",
+                   checkpoints, (collective ? golCheckpointRowOffset((uint64_t) tw * px, (uint64_t) th * py)
+                                            : golCheckpointRowOffset(tw, th) * commSize) / 1024.0,
+                   totalTimes[3] / commSize / checkpoints * 1e3);
         }
-        //SWAP
-        double *temp = currentfield;
-        currentfield = newfield;
-        newfield = temp;
     }
+#endif
+    if (rowComm != MPI_COMM_NULL) MPI_Comm_free(&rowComm);
+    if (collective) {
+        MPI_Type_free(&fileType);
+        free(outputBuffer);
+    }
+
+    for (int d = 0; d < 2 * DIRECTIONS; d++) {
+        MPI_Request_free(request + d);
+    }
+    MPI_Comm_free(&haloComm);
 
+    if (activity != NULL) {
+        free(activity->before);
+        free(activity->now);
+        free(activity);
+    }
     free(currentfield);
     free(newfield);
+    for (int d = 0; d < DIRECTIONS; d++) {
+        free(sendBuffer[d]);
+        free(recvBuffer[d]);
+    }
+
+}
+
+/**
+ * Ensemble mode: `count` independent w x h games with the seeds seed .. seed+count-1 instead of one game. Every rank
+ * runs a contiguous share of the instances with its threads, the first rank gathers the results and writes the summary
+ * to ensemble.csv.
+ */
+int ensemble(long timeSteps, int w, int h, int count, int check, int commSize) {
+    int *counts = malloc(commSize * sizeof(int));
+    int *offsets = malloc(commSize * sizeof(int));
+    for (int r = 0; r < commSize; r++) {
+        int first = (int) ((long) count * r / commSize);
+        offsets[r] = first * (int) sizeof(GolInstance);
+        counts[r] = ((int) ((long) count * (r + 1) / commSize) - first) * (int) sizeof(GolInstance);
+    }
+    int first = offsets[rank] / (int) sizeof(GolInstance);
+    int share = counts[rank] / (int) sizeof(GolInstance);
 
+    GolInstance *instances = calloc(count, sizeof(GolInstance));
+    if (instances == NULL) {
+        fprintf(stderr, "Could not allocate %d ensemble instances\n", count);
+        exit(1);
+    }
+    for (int i = first; i < first + share; i++) instances[i].seed = seed + i;
+    double seconds = golEnsembleRun(&instances[first], share, w, h, timeSteps, check, rowKernel, threadCount);
+    MPI_Reduce(rank == 0 ? MPI_IN_PLACE : &seconds, &seconds, 1, MPI_DOUBLE, MPI_MAX, 0, MPI_COMM_WORLD);
+    MPI_Gatherv(rank == 0 ? MPI_IN_PLACE : &instances[first], counts[rank], MPI_BYTE, instances, counts, offsets,
+                MPI_BYTE, 0, MPI_COMM_WORLD);
+    free(counts);
+    free(offsets);
+
+    int status = 0;
+    if (rank == 0) {
+        long generations = 0, population = 0;
+        int steady = 0;
+        for (int i = 0; i < count; i++) {
+            generations += instances[i].generations;
+            population += instances[i].population;
+            steady += instances[i].steady;
+        }
+#ifndef performance
+        printf("Ensemble: %d instances of %dx%d on %d ranks, %d steady, %.1f generations and %.1f live cells on "
+               "average\n", count, w, h, commSize, steady, (double) generations / count, (double) population / count);
+        printf("Throughput: %.3g cells/s, %.3g instances/s\n", (double) generations * w * h / seconds,
+               count / seconds);
+#endif
+        status = golEnsembleWrite("ensemble.csv", instances, count);
+    }
+    free(instances);
+    return status;
 }
 
 int main(int c, char **v) {
-    MPI_Init(&c, &v);
+    int provided;
+    MPI_Init_thread(&c, &v, MPI_THREAD_FUNNELED, &provided);
 
-    //srand(42 * 0x815);
     long n = 0;
     int tw = 0, th = 0, px = 0, py = 0;
+    char *kernelName = NULL;
+    char *modeName = NULL;
+    int temporal = 1;
+    int halo = 0;
+    int check = 1;
+    int activity = 256;
+    int stride = 1;
+    int checkpointEvery = 0;
+    int restart = 0;
+    char *output = NULL;
+    char *formatName = NULL;
+    char *timingFile = NULL;
+    const char *ruleName = NULL;
+    int instances = 0;
+
+    static struct option options[] = {
+            {"simd", required_argument, NULL, 's'},
+            {"mode", required_argument, NULL, 'm'},
+            {"temporal", required_argument, NULL, 'k'},
+            {"halo", required_argument, NULL, 'g'},
+            {"check", required_argument, NULL, 'c'},
+            {"activity", required_argument, NULL, 'a'},
+            {"threads", required_argument, NULL, 'T'},
+            {"output", required_argument, NULL, 'O'},
+            {"format", required_argument, NULL, 'f'},
+            {"zlib", no_argument, NULL, 'z'},
+            {"output-stride", required_argument, NULL, 'o'},
+            {"checkpoint", required_argument, NULL, 'C'},
+            {"restart", no_argument, NULL, 'R'},
+            {"timing", required_argument, NULL, 't'},
+            {"seed", required_argument, NULL, 'S'},
+            {"rule", required_argument, NULL, 'r'},
+            {"ensemble", required_argument, NULL, 'e'},
+            {NULL, 0, NULL, 0}
+    };
+    int option;
+    while ((option = getopt_long(c, v, "s:m:k:g:c:a:T:O:f:zo:C:Rt:S:r:e:", options, NULL)) != -1) {
+        switch (option) {
+            case 's': kernelName = optarg; break;   ///< read evolve kernel (auto, scalar, sse2, avx2, avx512)
+            case 'm': modeName = optarg; break;     ///< read evolve mode (stencil, rowsum)
+            case 'k': temporal = atoi(optarg); break;   ///< read generations per temporal block
+            case 'g': halo = atoi(optarg); break;       ///< read ghost layer depth = generations per halo exchange
+            case 'c': check = atoi(optarg); break;      ///< read halo periods per steady-state check, 0 disables it
+            case 'a': activity = atoi(optarg); break;   ///< read activity tile size in cells, 0 computes every cell
+            case 'T': threadCount = atoi(optarg); break;    ///< read OpenMP threads per rank
+            case 'O': output = optarg; break;       ///< read output mode (files, mpiio)
+            case 'f': formatName = optarg; break;   ///< read vtk payload format (float32, uint8, bit)
+            case 'z': vtkCompress = 1; break;       ///< zlib-compress the vtk payload
+            case 'o': stride = atoi(optarg); break; ///< read passes per written snapshot, 0 writes none
+            case 'C': checkpointEvery = atoi(optarg); break;    ///< read halo periods per checkpoint, 0 writes none
+            case 'R': restart = 1; break;           ///< restart from the checkpoint files
+            case 't': timingFile = optarg; break;   ///< read timing report file (.csv, .json)
+            case 'S': seed = strtoull(optarg, NULL, 0); break;  ///< read seed of the random initial field
+            case 'r': ruleName = optarg; break;     ///< read rule in B/S notation, e.g. B36/S23
+            case 'e': instances = atoi(optarg); break;  ///< read number of independent games, 0 runs a single one
+            default: MPI_Finalize(); return -1;
+        }
+    }
+    // the positional arguments follow the options
+    c -= optind - 1;
+    v += optind - 1;
+
     if(c > 1) n = atoi(v[1]);   ///< read timeSteps
     if (c > 2) tw = atoi(v[2]); ///< read process-width
     if (c > 3) th = atoi(v[3]); ///< read process-height
@@ -354,19 +1034,89 @@ int main(int c, char **v) {
     if (th <= 0) th = 10;       ///< default process-height
     if (px <= 0) px = 2;        ///< default process-count X
     if (py <= 0) py = 2;        ///< default process-count Y
+    if (temporal <= 0) temporal = 1;    ///< default: no temporal blocking
+    if (halo <= 0) halo = temporal;     ///< default: one exchange per temporal block
+    if (temporal > halo) temporal = halo;
+    if (check < 0) check = 1;           ///< default: check every halo period
+    if (threadCount <= 0) threadCount = 1;  ///< default: one thread per rank
+    if (stride < 0) stride = 1;             ///< default: a snapshot every pass
+    if (checkpointEvery < 0) checkpointEvery = 0;   ///< default: no checkpoints
+    int collective = output != NULL && strcmp(output, "mpiio") == 0;  ///< default: one file per rank
 
     int commSize;
 
     MPI_Comm_size(MPI_COMM_WORLD, &commSize);
-    if(commSize != px*py){
+    // in ensemble mode px and py only give the size of every instance, the ranks split the instances
+    if(instances <= 0 && commSize != px*py){
         printf("ERROR Comm-Size != px*py\n");
+        MPI_Finalize();
+        return -1;
+    }
+    if(halo > tw || halo > th){
+        printf("ERROR halo > process-width or process-height\n");
+        MPI_Finalize();
+        return -1;
+    }
+    vtkFormat = golSelectVtkFormat(formatName);
+    if (collective && (vtkFormat == GOL_VTK_BIT || vtkCompress)) {
+        printf("ERROR --output=mpiio needs an uncompressed float32 or uint8 payload\n");
+        // every rank reads the same options and leaves here
+        MPI_Finalize();
+        return -1;
+    }
+    // the rule is given, or taken from the header of file.rle, or Conway's
+    GolRle *pattern = ruleName == NULL ? golRleOpen("file.rle", 1) : NULL;
+    if (pattern != NULL && golRleRule(pattern)[0] != '\0') ruleName = golRleRule(pattern);
+    rule = GOL_RULE_CONWAY;
+    if (ruleName != NULL && golParseRule(ruleName, &rule) != 0) {
+        printf("ERROR unsupported rule %s\n", ruleName);
+        if (pattern != NULL) golRleClose(pattern);
+        // every rank reads the same file and options and leaves here
+        MPI_Finalize();
         return -1;
     }
+    if (pattern != NULL) golRleClose(pattern);
+    GolCheckpoint checkpoint;
+    if (restart) {
+        if (golCheckpointFind("checkpoint", &checkpoint) != 0) {
+            printf("ERROR no checkpoint to restart from\n");
+            // the ranks look for the files on their own, some of them may already be past this point
+            MPI_Abort(MPI_COMM_WORLD, 1);
+        }
+        if (checkpoint.gridWidth != (uint64_t) tw * px || checkpoint.gridHeight != (uint64_t) th * py) {
+            printf("ERROR checkpoint grid %lux%lu != %dx%d\n", (unsigned long) checkpoint.gridWidth,
+                   (unsigned long) checkpoint.gridHeight, tw * px, th * py);
+            MPI_Abort(MPI_COMM_WORLD, 1);
+        }
+        // later checkpoints keep the seed of the field the game started from, the game goes on under its rule
+        seed = checkpoint.seed;
+        rule.birth = checkpoint.birth;
+        rule.survive = checkpoint.survive;
+    }
     MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    if (provided < MPI_THREAD_FUNNELED && threadCount > 1) {
+        if (rank == 0) printf("WARNING MPI library without MPI_THREAD_FUNNELED, using one thread per rank\n");
+        threadCount = 1;
+    }
+
+    GolMode mode = golSelectMode(modeName);
+    GolKernel kernel = golSelectKernel(kernelName, mode, rule);
+    rowKernel = golRowKernel(kernel, mode, rule);
 
 #ifndef performance
-    printf("Initialized, Size: %d, Rank: %d\n", commSize, rank);
+    printf("Initialized, Size: %d, Rank: %d, Evolve kernel: %s, mode: %s, temporal blocking: %d, halo: %d, threads: %d\n", commSize, rank, golKernelName(kernel), golModeName(mode), temporal, halo, threadCount);
+    if (rank == 0) {
+        char ruleText[32];
+        golFormatRule(rule, ruleText, sizeof(ruleText));
+        printf("Rule: %s (%s kernel)\n", ruleText, golRuleKernelName(rule));
+    }
+    if (restart && rank == 0) printf("Restart from generation %ld\n", (long) checkpoint.generation);
 #endif
+    if (instances > 0) {
+        int status = ensemble(n, tw * px, th * py, instances, check, commSize);
+        MPI_Finalize();
+        return status == 0 ? 0 : -1;
+    }
 
     MPI_Comm comm;
     int dimensions[] = {px, py};
@@ -376,14 +1126,18 @@ int main(int c, char **v) {
     int coordinates[2];
     MPI_Cart_coords(comm, rank, 2, coordinates);
 
-    MPI_Cart_shift(comm, 1, 1, &left_neighbor, &right_neighbor);
-    MPI_Cart_shift(comm, 0, 1, &top_neighbor, &bottom_neighbor);
+    // dimension 0 is x (px processes), dimension 1 is y, the periodic grid wraps the coordinates
+    for (int d = 0; d < DIRECTIONS; d++) {
+        int neighbourCoordinates[2] = {coordinates[0] + directions[d][0], coordinates[1] + directions[d][1]};
+        MPI_Cart_rank(comm, neighbourCoordinates, &neighbours[d]);
+    }
 
 #ifndef performance
-    printf("[%d] Coordinates: (%d|%d)\tNeighbor-Left: %d\tNeighbor-Right: %d\tNeighbor-Top: %d\tNeighbor-Bottom: %d\n", rank, *coordinates, *(coordinates+1), left_neighbor, right_neighbor, top_neighbor, bottom_neighbor);
+    printf("[%d] Coordinates: (%d|%d)\tNeighbor-Left: %d\tNeighbor-Right: %d\tNeighbor-Top: %d\tNeighbor-Bottom: %d\n", rank, *coordinates, *(coordinates+1), neighbours[LEFT], neighbours[RIGHT], neighbours[TOP], neighbours[BOTTOM]);
 #endif
 
-    game(&comm, n, tw, th, px, py);
+    game(&comm, n, tw, th, px, py, halo, temporal, check, activity, collective, stride, checkpointEvery,
+         restart ? &checkpoint : NULL, timingFile);
 
     MPI_Finalize();
 }
\ No newline at end of file
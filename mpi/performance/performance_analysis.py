@@ -1,5 +1,6 @@
 import os
 import csv
+import json
 import sys
 import platform
 import itertools
@@ -20,35 +21,55 @@ if __name__ == "__main__":
     y_processes = x_processes
     processes = [x for x in itertools.product(x_processes, y_processes) if x[0]*x[1] <= cpu_count and x[0]*x[1] != 3]
     processes.sort(key=lambda t: t[0]*t[1])
+    # vtk output: one file per rank and step against one collective MPI-IO file per step
+    outputs = ["files", "mpiio"]
 
     # get arguments
     time_steps = int(sys.argv[1]) if len(sys.argv) > 1 and sys.argv[1].isdigit() else 100
     iterations = int(sys.argv[2]) if len(sys.argv) > 2 and sys.argv[1].isdigit() else 5
 
-    # list of tuples (PC, #Cores, grid-X, grid-Y, #processes, #processes-X, #processes-Y, process-Width, process-Height, times)
+    # list of tuples (PC, #Cores, grid-X, grid-Y, #processes, #processes-X, #processes-Y, process-Width, process-Height, output, times, AVG(time), memory, AVG(memory), ns/cell, AVG(cells/s), AVG(imbalance), AVG(halo), AVG(allreduce), AVG(generations))
+    # ns/cell = average time per cell update
     # times = list of elapsed seconds 
-    header_row = ("PC", "#Cores", "grid-X", "grid-Y", "#processes", "#processes-X", "#processes-Y", "process-Width", "process-Height", "times", "AVG(time)", "memory", "AVG(memory)")
+    # cells/s, imbalance and the seconds rank 0 waited for halo exchanges and steady-state reductions come from the
+    # program's timing report, see --timing
+    header_row = ("PC", "#Cores", "grid-X", "grid-Y", "#processes", "#processes-X", "#processes-Y", "process-Width", "process-Height", "output", "times", "AVG(time)", "memory", "AVG(memory)", "ns/cell", "AVG(cells/s)", "AVG(imbalance)", "AVG(halo)", "AVG(allreduce)", "AVG(generations)")
     result_list = []
 
     for total_width, total_height in grid_sizes:
         print("Grid Size:", total_width, "x", total_height)
         
-        for process_count_x, process_count_y in processes:
-            print("processes:", process_count_x * process_count_y, "X:", process_count_x, "Y:", process_count_y)
+        for (process_count_x, process_count_y), output in itertools.product(processes, outputs):
+            print("processes:", process_count_x * process_count_y, "X:", process_count_x, "Y:", process_count_y, "Output:", output)
             process_width = total_width // process_count_x
             process_height = total_height // process_count_y
 
             times = []
             mem = []
+            throughputs = []
+            imbalances = []
+            generations = []
+            ns_per_cells = []
+            halos = []
+            reductions = []
             for i in range(iterations):
-                result = sp.run(["/usr/bin/time", "--format=SEC:%e,MEM:%M", "mpirun", "-n", str(process_count_x * process_count_y), "../gameoflife", str(time_steps), str(process_width), str(process_height), str(process_count_x), str(process_count_y)], stderr=sp.PIPE)
+                result = sp.run(["/usr/bin/time", "--format=SEC:%e,MEM:%M", "mpirun", "-n", str(process_count_x * process_count_y), "../gameoflife", "--output=" + output, "--timing=timing.json", str(time_steps), str(process_width), str(process_height), str(process_count_x), str(process_count_y)], stderr=sp.PIPE)
                 time_output = result.stderr.decode("utf-8").split(",")
                 elapsed_s = float(time_output[0][4:])
                 memory_kb = int(time_output[1][4:])
                 print("ITERATION", i, "Elapsed time:", elapsed_s)
                 times.append(elapsed_s)
                 mem.append(memory_kb)
-            result_tuple = (pc_name, cpu_count, total_width, total_height, process_count_x * process_count_y, process_count_x, process_count_y, process_width, process_height, times, mean(times), mem, mean(mem))
+                with open("timing.json") as timing_file:
+                    timing = json.load(timing_file)
+                throughputs.append(timing["cells_per_second"])
+                imbalances.append(timing["imbalance"])
+                # a steady grid ends the run early, only the generations it computed count
+                generations.append(timing["generations"])
+                ns_per_cells.append(times[-1] * 1e9 / (total_width * total_height * generations[-1]))
+                halos.append(timing["workers"][0]["halo"])
+                reductions.append(timing["workers"][0]["allreduce"])
+            result_tuple = (pc_name, cpu_count, total_width, total_height, process_count_x * process_count_y, process_count_x, process_count_y, process_width, process_height, output, times, mean(times), mem, mean(mem), mean(ns_per_cells), mean(throughputs), mean(imbalances), mean(halos), mean(reductions), mean(generations))
             result_list.append(result_tuple)
     
 with open("results_"+pc_name+".csv", "w") as out:
@@ -1,47 +1,80 @@
 #include <stdio.h>
 #include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
 #include <unistd.h>
+#include <getopt.h>
+#include <sys/mman.h>
 
 #include <omp.h>
 
+#include "../simd/gol_kernel.h"
+#include "../simd/gol_vtk.h"
+#include "../simd/gol_snapshot.h"
+#include "../simd/gol_checkpoint.h"
+#include "../simd/gol_rle.h"
+#include "../simd/gol_timing.h"
+#include "../simd/gol_random.h"
+#include "../simd/gol_ensemble.h"
+#include "hashlife.h"
+
 #define calcIndex(width, x, y)  ((y)*(width) + (x))
 
+// cells are bit-packed: 64 cells per row word, cell x is bit (x % 64) of word (x / 64)
+#define WORD_BITS 64
+#define calcWords(width)  (((width) + WORD_BITS - 1) / WORD_BITS)
+#define getCell(field, words, x, y)  (((field)[calcIndex(words, (x) / WORD_BITS, y)] >> ((x) % WORD_BITS)) & 1)
+
 //#define performance
 
-void writeVTK2(long timestep, const double *data, char prefix[1024], int w, int tw, int th, int offsetX, int offsetY) {
+// tile edge in cells when the activity map is off, tiles are still the unit of work
+#define TILE_SIZE 256
+// a work unit spans at least this many cells of a row
+#define UNIT_CELLS 1024
+#define calcUnitTiles(tileW)  ((tileW) < UNIT_CELLS ? (UNIT_CELLS + (tileW) - 1) / (tileW) : 1)
+// temporal blocks are cut until every thread gets at least this many
+#define UNITS_PER_THREAD 4
+// grid buffers are aligned to transparent huge pages
+#define HUGE_PAGE (2 * 1024 * 1024)
+// generations that can wait for the I/O thread before the game blocks
+#define SNAPSHOT_BUFFERS 3
+// default seed of the random initial field
+#define SEED (42 * 0x815)
+
+GolRowKernel rowKernel;
+// threads per parallel region, independent of the px x py pieces the grid is written in
+int threadCount;
+// seed of the random initial field, recorded in the checkpoints
+uint64_t seed;
+// rule the cells evolve by, recorded in the checkpoints
+GolRule rule;
+// payload of the vtk files
+GolVtkFormat vtkFormat;
+int vtkCompress;
+
+void writeVTK2(long timestep, const uint64_t *data, char prefix[1024], int words, int tw, int th, int offsetX, int offsetY,
+               int piece) {
     char filename[2048];
-    int x, y;
 
     // int offsetX = 0;
     // int offsetY = 0;
     float deltax = 1.0;
-    long nxy = tw * th * sizeof(float);
-
-    int threadnum = omp_get_thread_num();
 
-    snprintf(filename, sizeof(filename), "%s-%05ld-%03d%s", prefix, timestep, threadnum, ".vti");
+    snprintf(filename, sizeof(filename), "%s-%05ld-%03d%s", prefix, timestep, piece, ".vti");
     FILE *fp = fopen(filename, "w");
 
     fprintf(fp, "<?xml version=\"1.0\"?>\n");
-    fprintf(fp, "<VTKFile type=\"ImageData\" version=\"0.1\" byte_order=\"LittleEndian\" header_type=\"UInt64\">\n");
+    fprintf(fp, "<VTKFile type=\"ImageData\" version=\"0.1\" byte_order=\"LittleEndian\" header_type=\"UInt64\"%s>\n",
+            golVtkCompressor(vtkCompress));
     fprintf(fp, "<ImageData WholeExtent=\"%d %d %d %d %d %d\" Origin=\"0 0 0\" Spacing=\"%le %le %le\">\n", offsetX,
             offsetX + tw, offsetY, offsetY + th, 0, 0, deltax, deltax, 0.0);
     fprintf(fp, "<CellData Scalars=\"%s\">\n", prefix);
-    fprintf(fp, "<DataArray type=\"Float32\" Name=\"%s\" format=\"appended\" offset=\"0\"/>\n", prefix);
+    fprintf(fp, "<DataArray type=\"%s\" Name=\"%s\" format=\"appended\" offset=\"0\"/>\n", golVtkTypeName(vtkFormat),
+            prefix);
     fprintf(fp, "</CellData>\n");
     fprintf(fp, "</ImageData>\n");
-    fprintf(fp, "<AppendedData encoding=\"raw\">\n");
-    fprintf(fp, "_");
-    fwrite((unsigned char *) &nxy, sizeof(long), 1, fp);
-
-    for (y = 0; y < th; y++) {
-        for (x = 0; x < tw; x++) {
-            float value = data[calcIndex(w, x + offsetX, y + offsetY)];
-            fwrite((unsigned char *) &value, sizeof(float), 1, fp);
-        }
-    }
-
-    fprintf(fp, "\n</AppendedData>\n");
+    // the whole piece is converted into one buffer and written at once
+    golVtkWriteCells(fp, data, words, offsetX, offsetY, tw, th, vtkFormat, vtkCompress);
     fprintf(fp, "</VTKFile>\n");
     fclose(fp);
 }
@@ -58,7 +91,8 @@ void writeVTK2_parallel(long timestep, char prefix[1024], char vti_prefix[1024],
     fprintf(fp, "<PImageData WholeExtent=\"%d %d %d %d %d %d\" Origin=\"0 0 0\" Spacing=\"%le %le %le\">\n", 0,
                 w, 0, h, 0, 0, 1.0, 1.0, 0.0);
     fprintf(fp, "<PCellData Scalars=\"%s\">\n", vti_prefix);
-    fprintf(fp, "<PDataArray type=\"Float32\" Name=\"%s\" format=\"appended\" offset=\"0\"/>\n", vti_prefix);
+    fprintf(fp, "<PDataArray type=\"%s\" Name=\"%s\" format=\"appended\" offset=\"0\"/>\n", golVtkTypeName(vtkFormat),
+            vti_prefix);
     fprintf(fp, "</PCellData>\n");
 
     for(int x = 0; x < px; x++){
@@ -82,191 +116,701 @@ void writeVTK2_parallel(long timestep, char prefix[1024], char vti_prefix[1024],
 
 }
 
+// the px x py pieces of tw x th cells the grid is written in
+typedef struct {
+    int px, py;
+    int tw, th;
+} Pieces;
+
+// per-thread buffers of evolve(), allocated once per game: a scratch row of the grid width and the dirty and active
+// flags of the tiles of a work unit
+typedef struct {
+    uint64_t *next;
+    int *tileDirty;
+    unsigned char *active;
+} Scratch;
+
+/**
+ * Writes the pieces of a generation and their .pvti index, runs on the I/O thread of the snapshot ring.
+ */
+void writePieces(long timestep, const uint64_t *field, void *context) {
+    const Pieces *pieces = context;
+    int w = pieces->tw * pieces->px;
+    int h = pieces->th * pieces->py;
+    for (int piece = 0; piece < pieces->px * pieces->py; piece++) {
+        writeVTK2(timestep, field, "gol", calcWords(w), pieces->tw, pieces->th, (piece % pieces->px) * pieces->tw,
+                  (piece / pieces->px) * pieces->th, piece);
+    }
+    writeVTK2_parallel(timestep, "golp", "gol", w, h, pieces->px, pieces->py);
+}
 
-void show(double *currentfield, int w, int h) {
+void show(uint64_t *currentfield, int w, int h) {
     printf("\033[H");
     int x, y;
+    int words = calcWords(w);
     for (y = 0; y < h; y++) {
-        for (x = 0; x < w; x++) printf(currentfield[calcIndex(w, x, y)] ? "\033[07m  \033[m" : "  ");
+        for (x = 0; x < w; x++) printf(getCell(currentfield, words, x, y) ? "\033[07m  \033[m" : "  ");
         printf("\033[E");
         printf("\n");
     }
     fflush(stdout);
 }
 
-int countLivingsPeriodic(double *currentfield, int x, int y, int w, int h) {
-    int n = 0;
-    for (int y1 = y - 1; y1 <= y + 1; y1++) {
-        for (int x1 = x - 1; x1 <= x + 1; x1++) {
-            if (currentfield[calcIndex(w, (x1 + w) % w, (y1 + h) % h)]) {
-                n++;
-            }
-        }
-    }
-    return n;
+/**
+ * Word j (-1 .. words) of a periodic row as its neighbours see it. Only the bits next to the row ends matter: word -1
+ * carries cell w-1 in its top bit, the partial last word and word `words` carry cell 0 right after cell w-1.
+ */
+uint64_t periodicWord(const uint64_t *row, int j, int w) {
+    int words = calcWords(w);
+    if (j < 0) return ((row[(w - 1) / WORD_BITS] >> ((w - 1) % WORD_BITS)) & 1) << (WORD_BITS - 1);
+    if (j >= words) return w % WORD_BITS == 0 ? row[0] & 1 : 0;
+    if (j == words - 1 && w % WORD_BITS != 0) return row[j] | ((row[0] & 1) << (w % WORD_BITS));
+    return row[j];
 }
 
+/**
+ * Next state of a border word, its outer neighbours come from the opposite end of the row.
+ */
+uint64_t evolveWordPeriodic(const uint64_t *above, const uint64_t *row, const uint64_t *below, int j, int w) {
+    return golEvolveWord(periodicWord(above, j - 1, w), periodicWord(above, j, w), periodicWord(above, j + 1, w),
+                         periodicWord(row, j - 1, w), periodicWord(row, j, w), periodicWord(row, j + 1, w),
+                         periodicWord(below, j - 1, w), periodicWord(below, j, w), periodicWord(below, j + 1, w),
+                         rule);
+}
 
-void evolve(int timestep, double *currentfield, double *newfield, int w, int h, int px, int py, int tw, int th) {
-
-#pragma omp parallel num_threads(px*py) default(none) shared(currentfield, newfield) firstprivate(timestep, px, tw, th,  w, h)
+/**
+ * Bits of the cells startX .. endX-1 that lie inside the given word.
+ */
+uint64_t cellMask(int word, int startX, int endX) {
+    int from = startX - word * WORD_BITS;
+    int to = endX - word * WORD_BITS;
+    if (from < 0) from = 0;
+    if (to > WORD_BITS) to = WORD_BITS;
+    if (from >= to) return 0;
+    uint64_t upper = to == WORD_BITS ? ~(uint64_t) 0 : ((uint64_t) 1 << to) - 1;
+    return upper & ~(((uint64_t) 1 << from) - 1);
+}
 
+/**
+ * Stores the bits selected by mask into *target.
+ * Words that are shared with a neighbouring tile are merged atomically, so two threads never lose each other's cells.
+ */
+void storeMasked(uint64_t *target, uint64_t bits, uint64_t mask) {
+    if (mask == ~(uint64_t) 0) {
+        *target = bits;
+    } else {
+        __atomic_fetch_and(target, ~mask, __ATOMIC_RELAXED);
+        __atomic_fetch_or(target, bits & mask, __ATOMIC_RELAXED);
+    }
+}
 
-    {
+/**
+ * Computes the next generation of the cells x0 .. x1-1 in the rows y0 .. y1-1, next is a scratch row of the grid width.
+ * If dirty is given, the range is split into tiles of tileW cells from x0 on and dirty[i] is set if a cell of tile i
+ * changed.
+ */
+void evolveTile(const uint64_t *currentfield, uint64_t *newfield, int w, int h, int x0, int x1, int y0, int y1,
+                uint64_t *next, int tileW, int *dirty) {
+    int words = calcWords(w);
+    int firstWord = x0 / WORD_BITS;
+    int lastWord = (x1 - 1) / WORD_BITS;
+
+    for (int y = y0; y < y1; y++) {
+        // only the first and last grid row take a neighbour row from the opposite end
+        const uint64_t *row = &currentfield[calcIndex(words, 0, y)];
+        const uint64_t *above = y > 0 ? row - words : &currentfield[calcIndex(words, 0, h - 1)];
+        const uint64_t *below = y < h - 1 ? row + words : currentfield;
+
+        // interior sweep: words with a neighbour word on both sides, no wrap logic
+        int from = firstWord > 1 ? firstWord : 1;
+        int to = lastWord < words - 2 ? lastWord + 1 : words - 1;
+        if (from < to) golEvolveRow(rowKernel, above, row, below, next, from, to, words);
+
+        // border pass: the first and last word of a grid row wrap around
+        if (firstWord == 0) next[0] = evolveWordPeriodic(above, row, below, 0, w);
+        if (lastWord == words - 1) next[words - 1] = evolveWordPeriodic(above, row, below, words - 1, w);
+
+        for (int word = firstWord; word <= lastWord; word++) {
+            storeMasked(&newfield[calcIndex(words, word, y)], next[word], cellMask(word, x0, x1));
+        }
 
-        int this_thread = omp_get_thread_num();
-
-        int x, y;
-        int tx = this_thread % px;
-        int ty = this_thread / px;
-        int offsetX = tx * tw;
-        int offsetY = ty * th;
-        //printf("THREAD: %i with offset (%i | %i)\n", this_thread, offsetX, offsetY);
-
-        for (y = 0; y < th; y++) {
-            for (x = 0; x < tw; x++) {
-                int n = countLivingsPeriodic(currentfield, x + offsetX, y + offsetY, w, h);
-                int index = calcIndex(w, x + offsetX, y + offsetY);
-                if (currentfield[index]) n--;
-                newfield[index] = (n == 3 || (n == 2 && currentfield[index]));
-
-                /*
-                printf(" INDEX: %d %i(%d|%d) = (%d + %d | %d + %d) \t\t n = %d \talive=%f\n",
-                        index,
-                        this_thread,
-                        x + offsetX,
-                        y + offsetY,
-                        x,
-                       offsetX,
-                       y,
-                       offsetY,
-                       n,
-                       currentfield[index]);
-                */
-            }
+        // the row is still in cache, comparing it tile by tile costs no extra pass over the grid
+        for (int i = 0; dirty != NULL && x0 + i * tileW < x1; i++) {
+            int end = x0 + (i + 1) * tileW < x1 ? x0 + (i + 1) * tileW : x1;
+            if (!dirty[i]) dirty[i] = golCellsDiffer(next, row, x0 + i * tileW, end);
         }
-#ifndef performance
-        writeVTK2(timestep, currentfield, "gol", w, tw, th, offsetX, offsetY);
-#endif
     }
 }
 
-void fillRandom(double *currentField, int w, int h) {
-    for (int i = 0; i < h * w; i++) {
-        currentField[i] = (rand() < RAND_MAX / 10) ? 1 : 0; ///< init domain randomly
+/**
+ * Returns 1 if the activity tile (ax, ay) or one of its eight neighbours changed, the tile map wraps around like the grid.
+ */
+int neighbourhoodChanged(const unsigned char *changed, int ax, int ay, int tilesX, int tilesY) {
+    for (int dy = -1; dy <= 1; dy++) {
+        int y = (ay + dy + tilesY) % tilesY;
+        for (int dx = -1; dx <= 1; dx++) {
+            if (changed[calcIndex(tilesX, (ax + dx + tilesX) % tilesX, y)]) return 1;
+        }
     }
+    return 0;
 }
 
-void readUntilNewLine(FILE *pFile) {
-    int readCharacter;
-    do {
-        readCharacter = fgetc(pFile);
-    } while (readCharacter != '\n' && readCharacter != EOF);
-}
+/**
+ * Computes the next generation, called by every thread of the game's parallel region; the threads leave without a
+ * barrier, the caller meets them at one. If check is set, *changed is set when any cell changed: each tile sets its
+ * dirty flag while storing its words, the flags are combined at the end.
+ *
+ * The grid is cut into tiles of tileW x tileH cells. A work unit is a run of tiles in one tile row, at least UNIT_CELLS
+ * wide so the row kernels see long rows; there are many more units than threads and they are handed out with the
+ * runtime schedule (dynamic unless OMP_SCHEDULE says otherwise), a thread that is done with its unit takes the next
+ * one, so uneven activity does not leave threads waiting.
+ *
+ * Sparse evolution: changedBefore marks the tiles that changed in the last generation; a tile whose neighbourhood did
+ * not change is skipped, newfield still holds the generation before, which equals the current one there. changedNow
+ * receives the marks for the next generation. Without a map (NULL) every tile is computed.
+ *
+ * scratch holds the calling thread's buffers, sized for the grid width and calcUnitTiles(tileW) tiles.
+ */
+void evolve(const uint64_t *currentfield, uint64_t *newfield, int w, int h, int check, int tileW, int tileH,
+            const unsigned char *changedBefore, unsigned char *changedNow, int *changed, const Scratch *scratch) {
+    int tilesX = (w + tileW - 1) / tileW;
+    int tilesY = (h + tileH - 1) / tileH;
+    int unitTiles = calcUnitTiles(tileW);
+    int unitsX = (tilesX + unitTiles - 1) / unitTiles;
+    int words = calcWords(w);
+    int track = check || changedNow != NULL;
+    int dirty = 0;
+    uint64_t *next = scratch->next;
+    int *tileDirty = scratch->tileDirty;
+    unsigned char *active = scratch->active;
+
+#pragma omp for schedule(runtime) nowait
+    for (int unit = 0; unit < unitsX * tilesY; unit++) {
+        int ay = unit / unitsX;
+        int first = (unit % unitsX) * unitTiles;
+        int count = first + unitTiles <= tilesX ? unitTiles : tilesX - first;
+        int y0 = ay * tileH;
+        int y1 = y0 + tileH < h ? y0 + tileH : h;
+        for (int i = 0; i < count; i++) {
+            active[i] = changedBefore == NULL || neighbourhoodChanged(changedBefore, first + i, ay, tilesX, tilesY);
+            tileDirty[i] = 0;
+        }
 
-void setCellState(double *currentField, int alive, int *index, int *count) {
-    //printf("Filling %d characters at index %d with %d\n", (*count), (*index), alive);
-    while((*count) > 0) {
-        currentField[(*index)] = (double)alive;
-        //printf("Setting %d to %d\n", (*index), alive);
-        (*index)++;
-        (*count)--;
+        // runs of active tiles are computed in one go, so the row kernels see long rows
+        for (int i = 0; i < count; ) {
+            if (!active[i]) {
+                i++;
+                continue;
+            }
+            int end = i;
+            while (end < count && active[end]) end++;
+            int x0 = (first + i) * tileW;
+            int x1 = (first + end) * tileW < w ? (first + end) * tileW : w;
+            evolveTile(currentfield, newfield, w, h, x0, x1, y0, y1, next, tileW, track ? &tileDirty[i] : NULL);
+            i = end;
+        }
+
+        for (int i = 0; i < count; i++) {
+            if (changedNow != NULL) changedNow[calcIndex(tilesX, first + i, ay)] = tileDirty[i];
+            dirty |= tileDirty[i];
+        }
+    }
+    if (dirty) {
+#pragma omp atomic write
+        *changed = 1;
     }
 }
 
-void fillFromFile(double *currentField, int w, char *fileName) {
-    FILE *file = fopen(fileName, "r");
-
-    //Files start with a 2 line header (comment + size/rule info)
-    readUntilNewLine(file);
-    readUntilNewLine(file);
+/**
+ * The 64 cells starting at cell x of a periodic row, x may lie outside 0 .. w-1.
+ */
+uint64_t periodicCells(const uint64_t *row, int x, int w) {
+    if (x >= 0 && x + WORD_BITS <= w) return golLoadCells(row, x, calcWords(w));
+    uint64_t cells = 0;
+    int cx = ((x % w) + w) % w;
+    for (int i = 0; i < WORD_BITS; i++) {
+        cells |= ((row[cx / WORD_BITS] >> (cx % WORD_BITS)) & 1) << i;
+        if (++cx == w) cx = 0;
+    }
+    return cells;
+}
 
-    int index = 0;
-    int count = 0;
+/**
+ * Temporal blocking: the grid is cut into L2-sized blocks, each block is advanced, together with a halo of
+ * `generations` cells copied from the periodic grid, by `generations` generations before the thread takes the next one.
+ * The grid is streamed through memory once per call instead of once per generation.
+ * Called by every thread of the game's parallel region. If check is set, *changed is set when any cell differs between
+ * the last two generations, so an oscillator whose period divides `generations` still counts as changing.
+ */
+void evolveBlocks(const uint64_t *currentfield, uint64_t *newfield, int w, int h, int generations, int check,
+                  int *changed) {
+    int blockWidth, blockHeight;
+    golBlockSize(w, h, generations, &blockWidth, &blockHeight);
+    int blocksX = (w + blockWidth - 1) / blockWidth;
+    int blocksY = (h + blockHeight - 1) / blockHeight;
+    // enough blocks for the schedule to balance them, at the price of more halo rows
+    while (blocksX * blocksY < UNITS_PER_THREAD * omp_get_num_threads() && blockHeight > generations) {
+        blockHeight = (blockHeight + 1) / 2;
+        blocksY = (h + blockHeight - 1) / blockHeight;
+    }
 
+    int words = calcWords(w);
+    int blockWords = calcWords(blockWidth + 2 * generations);
+    int blockRows = blockHeight + 2 * generations;
+    uint64_t *block = malloc(blockWords * blockRows * sizeof(uint64_t));
+    uint64_t *scratch = malloc(blockWords * blockRows * sizeof(uint64_t));
+    uint64_t *next = malloc((blockWords + 1) * sizeof(uint64_t));
+    int dirty = 0;
+
+#pragma omp for schedule(runtime) nowait
+    for (int b = 0; b < blocksX * blocksY; b++) {
+        int bx = (b % blocksX) * blockWidth;
+        int by = (b / blocksX) * blockHeight;
+        int rows = by + blockHeight <= h ? blockHeight : h - by;
+        int cols = bx + blockWidth <= w ? blockWidth : w - bx;
+        int left = bx - generations;
+        // block words from .. to-1 lie inside the grid row, the others wrap around its ends
+        int from = left >= 0 ? 0 : (WORD_BITS - 1 - left) / WORD_BITS;
+        int to = w - left >= 0 ? (w - left) / WORD_BITS : 0;
+        if (to > blockWords) to = blockWords;
+        if (to < from) to = from;
+
+        // copy the block and its halo, the halo wraps around the grid edges
+        for (int r = 0; r < rows + 2 * generations; r++) {
+            int y = ((by - generations + r) % h + h) % h;
+            const uint64_t *row = &currentfield[calcIndex(words, 0, y)];
+            uint64_t *target = &block[calcIndex(blockWords, 0, r)];
+            golLoadRow(&target[from], row, left + from * WORD_BITS, to - from, words);
+            for (int j = 0; j < from; j++) target[j] = periodicCells(row, left + j * WORD_BITS, w);
+            for (int j = to; j < blockWords; j++) target[j] = periodicCells(row, left + j * WORD_BITS, w);
+        }
 
-    int readCharacter = fgetc(file);
-    while(readCharacter != EOF) {
-        if(readCharacter >= '0' && readCharacter <= '9') {
-            count = count * 10 + (readCharacter - '0');
-        } else if(readCharacter == 'b' || readCharacter == 'o') {
-            int alive = readCharacter == 'o';
-            if(count == 0) {
-                //Direct color switch without preceding number
-                count = 1;
+        uint64_t *result = golAdvanceBlock(block, scratch, blockWords, rows + 2 * generations, generations, rowKernel);
+        // the other buffer holds the generation before, exact inside the block as well
+        const uint64_t *previous = result == block ? scratch : block;
+
+        // write back the block without its halo, words shared with other blocks are merged
+        int firstWord = bx / WORD_BITS;
+        int lastWord = (bx + cols - 1) / WORD_BITS;
+        for (int r = generations; r < rows + generations; r++) {
+            int y = by + r - generations;
+            if (check && !dirty) {
+                dirty = golCellsDiffer(&previous[calcIndex(blockWords, 0, r)], &result[calcIndex(blockWords, 0, r)],
+                                       generations, generations + cols);
             }
-            setCellState(currentField, alive, &index, &count);
-        } else if(readCharacter == '$' || readCharacter == '!') {
-            //End of line, or end of file -> Pad until end of line with empty cells
-            if((index % w) != 0) {
-                count = (w - (index % w));
+            golLoadRow(next, &result[calcIndex(blockWords, 0, r)], firstWord * WORD_BITS - left,
+                       lastWord - firstWord + 1, blockWords);
+            for (int word = firstWord; word <= lastWord; word++) {
+                uint64_t mask = cellMask(word, bx, bx + cols);
+                storeMasked(&newfield[calcIndex(words, word, y)], next[word - firstWord], mask);
             }
-            setCellState(currentField, 0, &index, &count);
-        } else if(readCharacter == '#') {
-            readUntilNewLine(file);
-        } else if(readCharacter == '\n') {
-
         }
-        else {
-            printf("Invalid character read: %d", readCharacter);
-            exit(1);
+    }
+    free(block);
+    free(scratch);
+    free(next);
+    if (dirty) {
+#pragma omp atomic write
+        *changed = 1;
+    }
+}
+
+/**
+ * HashLife step: one thread advances the whole grid by the engine's 2^k generations at once, then all threads compare
+ * the rows.
+ * If check is set, *changed is set when any cell differs between the two generations.
+ */
+void evolveHashLife(HashLife *life, const uint64_t *currentfield, uint64_t *newfield, int w, int h, int check,
+                    int *changed) {
+    int words = calcWords(w);
+    int dirty = 0;
+
+#pragma omp single
+    hashLifeAdvance(life, currentfield, newfield, w, h);
+
+#pragma omp for schedule(static) nowait
+    for (int y = 0; y < h; y++) {
+        if (check && !dirty) {
+            dirty = golCellsDiffer(&currentfield[calcIndex(words, 0, y)], &newfield[calcIndex(words, 0, y)], 0, w);
         }
+    }
+    if (dirty) {
+#pragma omp atomic write
+        *changed = 1;
+    }
+}
 
-        readCharacter = fgetc(file);
+/**
+ * Allocates a grid buffer for the given placement. Local placement aligns it to huge pages and asks for transparent
+ * huge pages, fewer TLB misses when a large grid is streamed; the memory is not touched here, the threads place its
+ * pages by first touch in game(). Master placement is a plain calloc() on the calling thread, every page lands on its
+ * NUMA node.
+ */
+uint64_t *allocateField(size_t bytes, int localPlacement) {
+    if (!localPlacement) return calloc(bytes, 1);
+
+    void *field;
+    bytes = (bytes + HUGE_PAGE - 1) / HUGE_PAGE * HUGE_PAGE;
+    if (posix_memalign(&field, HUGE_PAGE, bytes) != 0) {
+        fprintf(stderr, "Could not allocate %zu bytes for the grid\n", bytes);
+        exit(1);
     }
+#ifdef MADV_HUGEPAGE
+    madvise(field, bytes, MADV_HUGEPAGE);
+#endif
+    return field;
 }
 
-void filling(double *currentField, int w, int h, char *fileName) {
-    if (access(fileName, R_OK) == 0) {
-        //File exists
-        fillFromFile(currentField, w, fileName);
-    } else {
-        //File does not exist
-        fillRandom(currentField, w, h);
+/**
+ * Allocates the evolve() buffers of a thread for rows of `words` words and tiles of tileW cells.
+ */
+Scratch allocateScratch(int words, int tileW) {
+    Scratch scratch = {malloc(words * sizeof(uint64_t)), malloc(calcUnitTiles(tileW) * sizeof(int)),
+                       malloc(calcUnitTiles(tileW))};
+    if (scratch.next == NULL || scratch.tileDirty == NULL || scratch.active == NULL) {
+        fprintf(stderr, "Could not allocate the evolve buffers of a thread\n");
+        exit(1);
     }
+    return scratch;
 }
 
-void game(long timeSteps, int tw, int th, int px, int py) {
+/**
+ * Writes the generation in `field` to checkpoint.gol and returns the seconds it took.
+ */
+double writeCheckpoint(const uint64_t *field, int w, int h, long generation) {
+    double start = omp_get_wtime();
+    GolCheckpoint header = {GOL_CHECKPOINT_MAGIC, w, h, 0, 0, w, h, 1, generation, seed, rule.birth, rule.survive};
+    golCheckpointWrite("checkpoint.gol", &header, field, calcWords(w), 0, 0);
+    return omp_get_wtime() - start;
+}
+
+/**
+ * Fills the field randomly, called by every thread of the game's parallel region. Every cell follows from the seed and
+ * its coordinates, the threads fill their rows independently; the static schedule matches the first touch, every
+ * thread writes its own pages.
+ */
+void fillRandom(uint64_t *currentField, int w, int h) {
+#pragma omp for schedule(static)
+    for (int y = 0; y < h; y++) {
+        golRandomFill(currentField, calcWords(w), 0, y, 0, y, w, 1, seed);
+    }
+}
+
+/**
+ * Loads the memory-mapped RLE pattern, called by every thread of the game's parallel region: the threads scan the
+ * chunks for the rows they advance, one thread turns that into the starting row of every chunk, then the chunks are
+ * decoded in parallel, each into its own rows.
+ */
+void fillFromFile(uint64_t *currentField, int w, int h, GolRle *rle) {
+    int chunks = golRleChunks(rle);
+#pragma omp for schedule(dynamic)
+    for (int chunk = 0; chunk < chunks; chunk++) {
+        golRleScan(rle, chunk);
+    }
+#pragma omp single
+    golRleIndex(rle);
+#pragma omp for schedule(dynamic)
+    for (int chunk = 0; chunk < chunks; chunk++) {
+        if (golRleDecode(rle, chunk, currentField, calcWords(w), 0, 0, 0, 0, w, h) != 0) exit(1);
+    }
+}
+
+void game(long timeSteps, int tw, int th, int px, int py, int temporal, int check, int activity, HashLife *life,
+          int hashLog, int localPlacement, int stride, int checkpointEvery, const GolCheckpoint *restart,
+          const char *timingFile) {
     int w, h;
     w = tw * px;
     h = th * py;
+    int words = calcWords(w);
 
-    double *currentfield = calloc(w * h, sizeof(double));
-    double *newfield = calloc(w * h, sizeof(double));
+    // bit-packed rows: 64 cells per word instead of one double per cell
+    uint64_t *currentfield = allocateField(words * h * sizeof(uint64_t), localPlacement);
+    uint64_t *newfield = allocateField(words * h * sizeof(uint64_t), localPlacement);
 
     //printf("size unsigned %d, size long %d\n",sizeof(float), sizeof(long));
 
 
 
 
-    filling(currentfield, w, h, "file.rle");
-    long t;
-    for (t = 0; t < timeSteps; t++) {
-        //show(currentfield, w, h);
-        evolve(t, currentfield, newfield, w, h, px, py, tw, th);
+    // tiles: `activity` x `activity` cells, both activity maps start out with every tile marked as changed
+    int tileSize = activity > 0 ? activity : TILE_SIZE;
+    int tileW = tileSize < w ? tileSize : w;
+    int tileH = tileSize < h ? tileSize : h;
+    int tilesY = (h + tileH - 1) / tileH;
+    int tileCount = ((w + tileW - 1) / tileW) * tilesY;
+    unsigned char *changedBefore = NULL;
+    unsigned char *changedNow = NULL;
+    if (activity > 0) {
+        changedBefore = malloc(tileCount);
+        changedNow = malloc(tileCount);
+        memset(changedBefore, 1, tileCount);
+        memset(changedNow, 1, tileCount);
+    }
+
+    // temporal blocking and HashLife advance several generations per step, output is only written for the first of them
+    long step = life != NULL ? 1L << hashLog : temporal;
+    int changed = 0;
+    int running = 1;
+    // a restart goes on from the generation of the checkpoint up to timeSteps
+    long start = restart != NULL ? restart->generation : 0;
+    int checkpoints = 0;
+    double checkpointTime = 0;
+    // the pattern file is decoded by all threads, without one the field is filled randomly
+    GolRle *rle = NULL;
+    // seconds per phase of every thread, and the generations computed in the time loop and its wall time
+    GolTimes *times;
+    if (posix_memalign((void **) &times, sizeof(GolTimes), threadCount * sizeof(GolTimes)) != 0) {
+        fprintf(stderr, "Could not allocate the timing buffers\n");
+        exit(1);
+    }
+    memset(times, 0, threadCount * sizeof(GolTimes));
+    GolRun run = {"openmp", w, h, 0, 1, threadCount, 0};
+
+    // every `stride`-th step is copied into the snapshot ring and written by the I/O thread while the game goes on
+    Pieces pieces = {px, py, tw, th};
+    GolSnapshots *snapshots = NULL;
+#ifndef performance
+    if (stride > 0) snapshots = golSnapshotsCreate(SNAPSHOT_BUFFERS, words * h * sizeof(uint64_t), writePieces, &pieces);
+#endif
+
+    // one parallel region for the whole game: the threads stay on their places and meet at barriers between the steps
+#pragma omp parallel num_threads(threadCount) default(none) shared(currentfield, newfield, changedBefore, changedNow, changed, running, checkpoints, checkpointTime, rle, times, run) firstprivate(timeSteps, w, h, check, activity, life, step, words, tileW, tileH, tilesY, tileCount, localPlacement, snapshots, stride, start, checkpointEvery, restart)
+    {
+        // first touch: a page is placed on the NUMA node of the thread that touches it first. The tile rows are zeroed
+        // with a static schedule in thread order, so with OMP_PROC_BIND=close every socket holds one contiguous band of
+        // the grid, and with OMP_SCHEDULE=static every thread later computes the same rows on the same node
+        if (localPlacement) {
+#pragma omp for schedule(static)
+            for (int ay = 0; ay < tilesY; ay++) {
+                int y0 = ay * tileH;
+                int rows = y0 + tileH < h ? tileH : h - y0;
+                memset(&currentfield[calcIndex(words, 0, y0)], 0, words * rows * sizeof(uint64_t));
+                memset(&newfield[calcIndex(words, 0, y0)], 0, words * rows * sizeof(uint64_t));
+            }
+        }
+
+#pragma omp single
+        {
+            if (restart != NULL) {
+                if (golCheckpointLoad("checkpoint", restart, currentfield, words, 0, 0, 0, 0, w, h) != 0) exit(1);
+            } else {
+                rle = golRleOpen("file.rle", omp_get_num_threads() * UNITS_PER_THREAD);
+            }
+        }
+        if (rle != NULL) {
+            fillFromFile(currentfield, w, h, rle);
+#pragma omp single
+            golRleClose(rle);
+        } else if (restart == NULL) {
+            fillRandom(currentfield, w, h);
+        }
 
+        // the thread's evolve() buffers live as long as the game, no allocation per generation
+        Scratch scratch = allocateScratch(words, tileW);
+        GolTimes *own = &times[omp_get_thread_num()];
+        double loopStart = omp_get_wtime();
+        for (long t = start; running && t < timeSteps; t += step) {
+            //show(currentfield, w, h);
+            int generations = timeSteps - t < step ? timeSteps - t : step;
+            // steady-state check every `check`-th step; a HashLife step compares generations 2^k apart, a cycle of
+            // that length also ends the game
+            int checking = check > 0 && (t / step) % check == 0;
+            double evolveStart = omp_get_wtime();
+            // the remainder of a HashLife run is shorter than its step and falls back to temporal blocking
+            if (life != NULL && generations == step) evolveHashLife(life, currentfield, newfield, w, h, checking,
+                                                                    &changed);
+            else if (generations > 1) evolveBlocks(currentfield, newfield, w, h, generations, checking, &changed);
+            else evolve(currentfield, newfield, w, h, checking, tileW, tileH, changedBefore, changedNow, &changed, &scratch);
+            double evolveEnd = omp_get_wtime();
+#pragma omp barrier
+            double stepStart = omp_get_wtime();
+            // the thread that finishes the step books its work there, the others wait at the end of single
+            double singleWork = 0;
+
+            // one thread finishes the step, the barrier at the end of single publishes the swapped buffers
+#pragma omp single
+            {
 #ifndef performance
-        writeVTK2_parallel(t, "golp", "gol", w, h, px, py);    
+                if (snapshots != NULL && (t / step) % stride == 0) golSnapshot(snapshots, t, currentfield);
 
-        printf("%ld timestep\n", t);
+                printf("%ld timestep\n", t);
 #endif
-        //usleep(2000);
+                //usleep(2000);
+                double swapStart = omp_get_wtime();
+                own->seconds[GOL_PHASE_OUTPUT] += swapStart - stepStart;
+
+                if (checking && !changed) running = 0;
+                changed = 0;
+
+                //SWAP
+                uint64_t *temp = currentfield;
+                currentfield = newfield;
+                newfield = temp;
+
+                if (activity > 0) {
+                    if (generations > 1 || life != NULL) {
+                        // a temporal block or HashLife step does not track tiles, everything is computed again
+                        memset(changedNow, 1, tileCount);
+                    }
+                    unsigned char *tempChanged = changedBefore;
+                    changedBefore = changedNow;
+                    changedNow = tempChanged;
+                }
+                run.generations = t + generations - start;
+                double swapEnd = omp_get_wtime();
+                own->seconds[GOL_PHASE_SWAP] += swapEnd - swapStart;
+                singleWork = swapEnd - stepStart;
+
+                // every `checkpointEvery`-th step the new generation is saved, the game can be restarted from it
+                if (checkpointEvery > 0 && ((t - start) / step + 1) % checkpointEvery == 0) {
+                    double seconds = writeCheckpoint(currentfield, w, h, t + generations);
+                    checkpoints++;
+                    checkpointTime += seconds;
+                    own->seconds[GOL_PHASE_CHECKPOINT] += seconds;
+                    singleWork += seconds;
+#ifndef performance
+                    printf("%ld checkpoint: %.3f ms\n", t + generations, seconds * 1e3);
+#endif
+                }
+            }
+            own->seconds[GOL_PHASE_EVOLVE] += evolveEnd - evolveStart;
+            own->seconds[GOL_PHASE_BARRIER] += stepStart - evolveEnd + omp_get_wtime() - stepStart - singleWork;
+        }
+        free(scratch.next);
+        free(scratch.tileDirty);
+        free(scratch.active);
+#pragma omp master
+        {
+            run.seconds = omp_get_wtime() - loopStart;
+            run.threads = omp_get_num_threads();
+        }
+    }
 
-        //SWAP
-        double *temp = currentfield;
-        currentfield = newfield;
-        newfield = temp;
+    if (snapshots != NULL) {
+        double stall = golSnapshotStall(snapshots);
+        golSnapshotsFree(snapshots);
+#ifndef performance
+        printf("Snapshots: %.3f s waiting for the I/O thread\n", stall);
+#endif
     }
+#ifndef performance
+    printf("Throughput: %.3g cells/s, imbalance: %.2f\n", golCellsPerSecond(&run), golImbalance(&run, times));
+    if (checkpoints > 0) {
+        printf("Checkpoints: %d of %.1f KiB, %.3f ms each\n", checkpoints, golCheckpointRowOffset(w, h) / 1024.0,
+               checkpointTime / checkpoints * 1e3);
+    }
+#endif
+    if (timingFile != NULL) golTimingWrite(timingFile, &run, times);
+    free(times);
+
+    free(changedBefore);
+    free(changedNow);
 
     free(currentfield);
     free(newfield);
 
 }
 
+/**
+ * Ensemble mode: `count` independent w x h games with the seeds seed .. seed+count-1 instead of one game, the summary
+ * goes to ensemble.csv.
+ */
+int ensemble(long timeSteps, int w, int h, int count, int check) {
+    GolInstance *instances = calloc(count, sizeof(GolInstance));
+    if (instances == NULL) {
+        fprintf(stderr, "Could not allocate %d ensemble instances\n", count);
+        exit(1);
+    }
+    for (int i = 0; i < count; i++) instances[i].seed = seed + i;
+    double seconds = golEnsembleRun(instances, count, w, h, timeSteps, check, rowKernel, threadCount);
+
+    long generations = 0, population = 0;
+    int steady = 0;
+    for (int i = 0; i < count; i++) {
+        generations += instances[i].generations;
+        population += instances[i].population;
+        steady += instances[i].steady;
+    }
+#ifndef performance
+    printf("Ensemble: %d instances of %dx%d, %d steady, %.1f generations and %.1f live cells on average\n", count, w, h,
+           steady, (double) generations / count, (double) population / count);
+    printf("Throughput: %.3g cells/s, %.3g instances/s\n", (double) generations * w * h / seconds, count / seconds);
+#endif
+    int status = golEnsembleWrite("ensemble.csv", instances, count);
+    free(instances);
+    return status;
+}
+
 int main(int c, char **v) {
-    srand(42 * 0x815);
     long n = 0;
     int tw = 0, th = 0, px = 0, py = 0;
+    char *kernelName = NULL;
+    char *modeName = NULL;
+    int temporal = 1;
+    int check = 1;
+    int activity = 256;
+    int hashLog = -1;
+    long hashMemory = 1024;
+    char *placement = NULL;
+    char *formatName = NULL;
+    int stride = 1;
+    int checkpointEvery = 0;
+    int restart = 0;
+    char *timingFile = NULL;
+    const char *ruleName = NULL;
+    int instances = 0;
+    threadCount = 0;
+    seed = SEED;
+
+    static struct option options[] = {
+            {"simd", required_argument, NULL, 's'},
+            {"mode", required_argument, NULL, 'm'},
+            {"temporal", required_argument, NULL, 'k'},
+            {"check", required_argument, NULL, 'c'},
+            {"activity", required_argument, NULL, 'a'},
+            {"hashlife", required_argument, NULL, 'L'},
+            {"hashlife-memory", required_argument, NULL, 'M'},
+            {"threads", required_argument, NULL, 'T'},
+            {"placement", required_argument, NULL, 'P'},
+            {"format", required_argument, NULL, 'f'},
+            {"zlib", no_argument, NULL, 'z'},
+            {"output-stride", required_argument, NULL, 'o'},
+            {"checkpoint", required_argument, NULL, 'C'},
+            {"restart", no_argument, NULL, 'R'},
+            {"timing", required_argument, NULL, 't'},
+            {"seed", required_argument, NULL, 'S'},
+            {"rule", required_argument, NULL, 'r'},
+            {"ensemble", required_argument, NULL, 'e'},
+            {NULL, 0, NULL, 0}
+    };
+    int option;
+    while ((option = getopt_long(c, v, "s:m:k:c:a:L:M:T:P:f:zo:C:Rt:S:r:e:", options, NULL)) != -1) {
+        switch (option) {
+            case 's': kernelName = optarg; break;   ///< read evolve kernel (auto, scalar, sse2, avx2, avx512)
+            case 'm': modeName = optarg; break;     ///< read evolve mode (stencil, rowsum)
+            case 'k': temporal = atoi(optarg); break;   ///< read generations per temporal block
+            case 'c': check = atoi(optarg); break;      ///< read steps per steady-state check, 0 disables it
+            case 'a': activity = atoi(optarg); break;   ///< read activity tile size in cells, 0 computes every cell
+            case 'L': hashLog = atoi(optarg); break;    ///< read log2 of the generations per HashLife step
+            case 'M': hashMemory = atol(optarg); break; ///< read HashLife memory budget in MiB
+            case 'T': threadCount = atoi(optarg); break;    ///< read thread count
+            case 'P': placement = optarg; break;    ///< read grid placement (local, master)
+            case 'f': formatName = optarg; break;   ///< read vtk payload format (float32, uint8, bit)
+            case 'z': vtkCompress = 1; break;       ///< compress the vtk payload with zlib
+            case 'o': stride = atoi(optarg); break; ///< read steps per written snapshot, 0 writes none
+            case 'C': checkpointEvery = atoi(optarg); break;    ///< read steps per checkpoint, 0 writes none
+            case 'R': restart = 1; break;           ///< restart from checkpoint.gol
+            case 't': timingFile = optarg; break;   ///< read timing report file (.csv, .json)
+            case 'S': seed = strtoull(optarg, NULL, 0); break;  ///< read seed of the random initial field
+            case 'r': ruleName = optarg; break;     ///< read rule in B/S notation, e.g. B36/S23
+            case 'e': instances = atoi(optarg); break;  ///< read number of independent games, 0 runs a single one
+            default: return -1;
+        }
+    }
+    // the positional arguments follow the options
+    c -= optind - 1;
+    v += optind - 1;
+
     if(c > 1) n = atoi(v[1]);   ///< read timeSteps
     if (c > 2) tw = atoi(v[2]); ///< read thread-width
     if (c > 3) th = atoi(v[3]); ///< read thread-height
@@ -277,6 +821,73 @@ int main(int c, char **v) {
     if (th <= 0) th = 12;       ///< default thread-height
     if (px <= 0) px = 1;        ///< default thread-count X
     if (py <= 0) py = 1;        ///< default thread-count Y
+    if (threadCount <= 0) threadCount = px * py;    ///< default: one thread per piece
+    int localPlacement = placement == NULL || strcmp(placement, "master") != 0;  ///< default: pages local to the threads
+    if (temporal <= 0) temporal = 1;    ///< default: no temporal blocking
+    if (check < 0) check = 1;           ///< default: check every step
+    if (hashLog > 40) hashLog = 40;     ///< 2^40 generations per step at most
+    if (hashMemory <= 0) hashMemory = 1024; ///< default HashLife budget: 1 GiB
+    if (stride < 0) stride = 1;         ///< default: a snapshot every step
+    if (checkpointEvery < 0) checkpointEvery = 0;   ///< default: no checkpoints
+
+    // the rule is given, or taken from the header of file.rle, or Conway's
+    GolRle *pattern = ruleName == NULL ? golRleOpen("file.rle", 1) : NULL;
+    if (pattern != NULL && golRleRule(pattern)[0] != '\0') ruleName = golRleRule(pattern);
+    rule = GOL_RULE_CONWAY;
+    if (ruleName != NULL && golParseRule(ruleName, &rule) != 0) {
+        printf("ERROR unsupported rule %s\n", ruleName);
+        if (pattern != NULL) golRleClose(pattern);
+        return -1;
+    }
+    if (pattern != NULL) golRleClose(pattern);
 
-    game(n, tw, th, px, py);
+    GolCheckpoint checkpoint;
+    if (restart) {
+        if (golCheckpointFind("checkpoint", &checkpoint) != 0) {
+            printf("ERROR no checkpoint to restart from\n");
+            return -1;
+        }
+        if (checkpoint.gridWidth != (uint64_t) tw * px || checkpoint.gridHeight != (uint64_t) th * py) {
+            printf("ERROR checkpoint grid %lux%lu != %dx%d\n", (unsigned long) checkpoint.gridWidth,
+                   (unsigned long) checkpoint.gridHeight, tw * px, th * py);
+            return -1;
+        }
+        // later checkpoints keep the seed of the field the game started from, the game goes on under its rule
+        seed = checkpoint.seed;
+        rule.birth = checkpoint.birth;
+        rule.survive = checkpoint.survive;
+    }
+
+    // work units are handed out dynamically unless OMP_SCHEDULE asks for something else
+    if (getenv("OMP_SCHEDULE") == NULL) omp_set_schedule(omp_sched_dynamic, 1);
+
+    vtkFormat = golSelectVtkFormat(formatName);
+
+    GolMode mode = golSelectMode(modeName);
+    GolKernel kernel = golSelectKernel(kernelName, mode, rule);
+    rowKernel = golRowKernel(kernel, mode, rule);
+#ifndef performance
+    char ruleText[32];
+    golFormatRule(rule, ruleText, sizeof(ruleText));
+    printf("Evolve kernel: %s, mode: %s, temporal blocking: %d, threads: %d\n", golKernelName(kernel), golModeName(mode),
+           temporal, threadCount);
+    printf("Rule: %s (%s kernel)\n", ruleText, golRuleKernelName(rule));
+    // the binding is read from OMP_PROC_BIND and OMP_PLACES when the program starts
+    const char *bindNames[] = {"false", "true", "master", "close", "spread"};
+    printf("Thread binding: %s, places: %d, grid placement: %s\n", bindNames[omp_get_proc_bind()], omp_get_num_places(),
+           localPlacement ? "local" : "master");
+    if (hashLog >= 0) printf("HashLife: 2^%d generations per step, memory budget: %ld MiB\n", hashLog, hashMemory);
+    if (restart) printf("Restart from generation %ld\n", (long) checkpoint.generation);
+#endif
+    if (instances > 0) return ensemble(n, tw * px, th * py, instances, check) == 0 ? 0 : -1;
+
+    HashLife *life = hashLog >= 0 ? hashLifeCreate(hashLog, (size_t) hashMemory << 20, rule) : NULL;
+    game(n, tw, th, px, py, temporal, check, activity, life, hashLog, localPlacement, stride, checkpointEvery,
+         restart ? &checkpoint : NULL, timingFile);
+    if (life != NULL) {
+#ifndef performance
+        printf("HashLife nodes: %zu, collections: %ld\n", hashLifeNodes(life), hashLifeCollections(life));
+#endif
+        hashLifeFree(life);
+    }
 }
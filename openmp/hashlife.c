@@ -0,0 +1,503 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "hashlife.h"
+
+#define WORD_BITS 64
+#define calcWords(width)  (((width) + WORD_BITS - 1) / WORD_BITS)
+
+// nodes of a level are 2^level x 2^level cells, level 0 are single cells
+#define MAX_LEVEL 62
+// nodes are allocated in chunks, the collector hands dead nodes out again and releases chunks without a live node
+#define CHUNK_NODES 65536
+// smallest size of the node table, it is fitted to the live nodes after every collection
+#define MIN_CAPACITY (1 << 16)
+// the grid import memoizes nodes from this level on, smaller ones are cheaper to build again
+#define IMPORT_MEMO_LEVEL 3
+// base case table: one entry per 4 x 4 node
+#define BASE_ENTRIES (1 << 16)
+
+typedef struct Node {
+    struct Node *nw, *ne, *sw, *se;
+    struct Node *result;    ///< memoized center after min(2^(level-2), 2^stepLog) generations
+    int level;
+    uint8_t alive;          ///< any cell alive, empty nodes are never evolved
+    uint8_t marked;         ///< reachable from a root during a collection
+} Node;
+
+typedef struct NodeChunk {
+    struct NodeChunk *next;
+    Node nodes[CHUNK_NODES];
+} NodeChunk;
+
+typedef struct {
+    uint64_t key;   ///< level, x and y of the node in the grid plus one, 0 marks an empty slot
+    Node *node;
+} ImportEntry;
+
+struct HashLife {
+    int stepLog;
+    size_t memoryBytes;
+    long collections;
+    size_t collectAt;       ///< no collection before the table holds this many nodes, see collect()
+
+    // center 2 x 2 cells of every 4 x 4 node after one generation, see buildBase()
+    uint8_t base[BASE_ENTRIES];
+
+    // canonical nodes: open addressing on the four children
+    Node **table;
+    size_t capacity;
+    size_t count;
+    NodeChunk *chunks;
+    int chunkUsed;
+    Node *freeNodes;        ///< dead nodes left by the last collection, linked through nw
+    Node *empty[MAX_LEVEL + 1];
+
+    // nodes the running step still needs, the roots of a collection besides the empty nodes and the import memo
+    Node **stack;
+    size_t stackCount;
+    size_t stackCapacity;
+
+    // grid the quadtree is built from
+    const uint64_t *field;
+    int w, h, words;
+    ImportEntry *memo;
+    size_t memoCapacity;
+    size_t memoCount;
+};
+
+static Node deadCell = {NULL, NULL, NULL, NULL, NULL, 0, 0, 0};
+static Node aliveCell = {NULL, NULL, NULL, NULL, NULL, 0, 1, 0};
+
+static size_t hashChildren(const Node *nw, const Node *ne, const Node *sw, const Node *se) {
+    uint64_t hash = (uintptr_t) nw;
+    hash = hash * 0x9E3779B97F4A7C15ULL + (uintptr_t) ne;
+    hash = hash * 0x9E3779B97F4A7C15ULL + (uintptr_t) sw;
+    hash = hash * 0x9E3779B97F4A7C15ULL + (uintptr_t) se;
+    return (size_t) (hash ^ (hash >> 29));
+}
+
+/**
+ * Moves the nodes into a new table of the given capacity, a power of two.
+ */
+static void rehash(HashLife *life, size_t capacity) {
+    Node **table = calloc(capacity, sizeof(Node *));
+    if (table == NULL) {
+        fprintf(stderr, "Could not allocate the HashLife node table\n");
+        exit(1);
+    }
+    for (size_t i = 0; i < life->capacity; i++) {
+        Node *node = life->table[i];
+        if (node == NULL) continue;
+        size_t slot = hashChildren(node->nw, node->ne, node->sw, node->se) & (capacity - 1);
+        while (table[slot] != NULL) slot = (slot + 1) & (capacity - 1);
+        table[slot] = node;
+    }
+    free(life->table);
+    life->table = table;
+    life->capacity = capacity;
+}
+
+/**
+ * Keeps a node alive until the stack is cut back below it.
+ */
+static void push(HashLife *life, Node *node) {
+    if (life->stackCount == life->stackCapacity) {
+        life->stackCapacity = life->stackCapacity > 0 ? life->stackCapacity * 2 : 256;
+        life->stack = realloc(life->stack, life->stackCapacity * sizeof(Node *));
+        if (life->stack == NULL) {
+            fprintf(stderr, "Could not allocate the HashLife root stack\n");
+            exit(1);
+        }
+    }
+    life->stack[life->stackCount++] = node;
+}
+
+static void mark(Node *node) {
+    if (node->level == 0 || node->marked) return;
+    node->marked = 1;
+    mark(node->nw);
+    mark(node->ne);
+    mark(node->sw);
+    mark(node->se);
+    // a live node keeps its memoized result
+    if (node->result != NULL) mark(node->result);
+}
+
+/**
+ * Garbage collection: keeps the nodes reachable from the stack, the empty nodes and the import memo together with
+ * their memoized results, hands the others out again and releases the chunks without a live node. The table is
+ * rebuilt for the live nodes only, so it shrinks with them.
+ *
+ * If the live nodes alone take most of the budget, the next collection waits until their number has doubled, so the
+ * step still finishes in amortized constant time per node.
+ */
+static void collect(HashLife *life) {
+    for (size_t i = 0; i < life->stackCount; i++) mark(life->stack[i]);
+    for (int level = 1; level <= MAX_LEVEL; level++) {
+        if (life->empty[level] != NULL) mark(life->empty[level]);
+    }
+    for (size_t i = 0; i < life->memoCapacity; i++) {
+        if (life->memo[i].key != 0) mark(life->memo[i].node);
+    }
+
+    size_t live = 0;
+    life->freeNodes = NULL;
+    NodeChunk **link = &life->chunks;
+    while (*link != NULL) {
+        NodeChunk *chunk = *link;
+        int used = chunk == life->chunks ? life->chunkUsed : CHUNK_NODES;
+        size_t chunkLive = 0;
+        Node *freeNodes = life->freeNodes;
+        for (int i = 0; i < used; i++) {
+            Node *node = &chunk->nodes[i];
+            if (node->marked) {
+                node->marked = 0;
+                chunkLive++;
+            } else {
+                // level 0 tells a dead node from a live one when the table is rebuilt
+                node->level = 0;
+                node->nw = freeNodes;
+                freeNodes = node;
+            }
+        }
+        if (chunkLive == 0) {
+            // only the first chunk is partly used, the one after it becomes the first
+            if (chunk == life->chunks) life->chunkUsed = CHUNK_NODES;
+            *link = chunk->next;
+            free(chunk);
+            continue;
+        }
+        live += chunkLive;
+        life->freeNodes = freeNodes;
+        link = &chunk->next;
+    }
+    if (life->chunks == NULL) life->chunkUsed = 0;
+
+    // the table keeps only the live nodes, at most a quarter full
+    size_t capacity = MIN_CAPACITY;
+    while (capacity < 4 * live) capacity *= 2;
+    free(life->table);
+    life->table = calloc(capacity, sizeof(Node *));
+    if (life->table == NULL) {
+        fprintf(stderr, "Could not allocate the HashLife node table\n");
+        exit(1);
+    }
+    life->capacity = capacity;
+    life->count = live;
+    for (NodeChunk *chunk = life->chunks; chunk != NULL; chunk = chunk->next) {
+        int used = chunk == life->chunks ? life->chunkUsed : CHUNK_NODES;
+        for (int i = 0; i < used; i++) {
+            Node *node = &chunk->nodes[i];
+            if (node->level == 0) continue;
+            size_t slot = hashChildren(node->nw, node->ne, node->sw, node->se) & (capacity - 1);
+            while (life->table[slot] != NULL) slot = (slot + 1) & (capacity - 1);
+            life->table[slot] = node;
+        }
+    }
+    life->collectAt = 2 * live;
+    life->collections++;
+}
+
+/**
+ * The canonical node with the given children, every distinct quadtree exists only once. A new node that would take
+ * the nodes and the table past the memory budget starts a collection first.
+ */
+static Node *join(HashLife *life, Node *nw, Node *ne, Node *sw, Node *se) {
+    size_t slot = hashChildren(nw, ne, sw, se) & (life->capacity - 1);
+    Node *node;
+    while ((node = life->table[slot]) != NULL) {
+        if (node->nw == nw && node->ne == ne && node->sw == sw && node->se == se) return node;
+        slot = (slot + 1) & (life->capacity - 1);
+    }
+
+    if (life->count >= life->collectAt &&
+        (life->count + 1) * sizeof(Node) + life->capacity * sizeof(Node *) > life->memoryBytes) {
+        size_t top = life->stackCount;
+        push(life, nw);
+        push(life, ne);
+        push(life, sw);
+        push(life, se);
+        collect(life);
+        life->stackCount = top;
+        // the table was rebuilt, the node is not in it
+        slot = hashChildren(nw, ne, sw, se) & (life->capacity - 1);
+        while (life->table[slot] != NULL) slot = (slot + 1) & (life->capacity - 1);
+    }
+
+    if (life->freeNodes != NULL) {
+        node = life->freeNodes;
+        life->freeNodes = node->nw;
+    } else {
+        if (life->chunks == NULL || life->chunkUsed == CHUNK_NODES) {
+            NodeChunk *chunk = malloc(sizeof(NodeChunk));
+            if (chunk == NULL) {
+                fprintf(stderr, "Could not allocate HashLife nodes\n");
+                exit(1);
+            }
+            chunk->next = life->chunks;
+            life->chunks = chunk;
+            life->chunkUsed = 0;
+        }
+        node = &life->chunks->nodes[life->chunkUsed++];
+    }
+    node->nw = nw;
+    node->ne = ne;
+    node->sw = sw;
+    node->se = se;
+    node->result = NULL;
+    node->level = nw->level + 1;
+    node->alive = nw->alive | ne->alive | sw->alive | se->alive;
+    node->marked = 0;
+
+    life->table[slot] = node;
+    if (++life->count * 2 > life->capacity) rehash(life, life->capacity * 2);
+    return node;
+}
+
+static Node *emptyNode(HashLife *life, int level) {
+    if (level == 0) return &deadCell;
+    if (life->empty[level] == NULL) {
+        Node *child = emptyNode(life, level - 1);
+        life->empty[level] = join(life, child, child, child, child);
+    }
+    return life->empty[level];
+}
+
+/**
+ * Fills the base case table: bit y * 4 + x of an index is cell (x, y) of a 4 x 4 node, bit i of its entry the center
+ * cell (1 + i % 2, 1 + i / 2) after one generation under the rule.
+ */
+static void buildBase(HashLife *life, GolRule rule) {
+    for (int cells = 0; cells < BASE_ENTRIES; cells++) {
+        uint8_t next = 0;
+        for (int i = 0; i < 4; i++) {
+            int x = 1 + i % 2;
+            int y = 1 + i / 2;
+            int neighbours = 0;
+            for (int dy = -1; dy <= 1; dy++) {
+                for (int dx = -1; dx <= 1; dx++) {
+                    if (dx != 0 || dy != 0) neighbours += (cells >> ((y + dy) * 4 + x + dx)) & 1;
+                }
+            }
+            int alive = (cells >> (y * 4 + x)) & 1;
+            if (((alive ? rule.survive : rule.birth) >> neighbours) & 1) next |= 1 << i;
+        }
+        life->base[cells] = next;
+    }
+}
+
+/**
+ * Center 2 x 2 cells of a 4 x 4 node after one generation, a single lookup in the base case table.
+ */
+static Node *evolveBase(HashLife *life, Node *node) {
+    Node *quadrants[4] = {node->nw, node->ne, node->sw, node->se};
+    int cells = 0;
+    for (int y = 0; y < 4; y++) {
+        for (int x = 0; x < 4; x++) {
+            Node *quadrant = quadrants[(y / 2) * 2 + x / 2];
+            Node *cellNodes[4] = {quadrant->nw, quadrant->ne, quadrant->sw, quadrant->se};
+            cells |= cellNodes[(y % 2) * 2 + x % 2]->alive << (y * 4 + x);
+        }
+    }
+
+    int center = life->base[cells];
+    Node *next[4];
+    for (int i = 0; i < 4; i++) next[i] = (center >> i) & 1 ? &aliveCell : &deadCell;
+    return join(life, next[0], next[1], next[2], next[3]);
+}
+
+/**
+ * Center node of the four nodes a (nw), b (ne), c (sw), d (se) of the same level.
+ */
+static Node *centerOf(HashLife *life, Node *a, Node *b, Node *c, Node *d) {
+    return join(life, a->se, b->sw, c->ne, d->nw);
+}
+
+/**
+ * Pushes a node the caller holds on to while it creates other nodes, a collection would drop it otherwise.
+ */
+static Node *keep(HashLife *life, Node *node) {
+    push(life, node);
+    return node;
+}
+
+/**
+ * The center half of a node of level >= 2 after min(2^(level-2), 2^stepLog) generations.
+ *
+ * The node is cut into nine overlapping sub-nodes of half its size. Up to the step size, their results are combined
+ * into four nodes which are advanced once more, doubling the generations per level. Above the step size, the four
+ * nodes are only cut to their centers, so every level advances exactly 2^stepLog generations.
+ *
+ * The node and the partial results stay on the stack until the result is memoized, the caller gets it unprotected and
+ * has to keep it before creating another node.
+ */
+static Node *successor(HashLife *life, Node *node) {
+    if (node->result != NULL) return node->result;
+    size_t top = life->stackCount;
+    push(life, node);
+    if (!node->alive) {
+        node->result = emptyNode(life, node->level - 1);
+    } else if (node->level == 2) {
+        node->result = evolveBase(life, node);
+    } else {
+        Node *a = node->nw, *b = node->ne, *c = node->sw, *d = node->se;
+        Node *n00 = keep(life, successor(life, a));
+        Node *n01 = keep(life, successor(life, join(life, a->ne, b->nw, a->se, b->sw)));
+        Node *n02 = keep(life, successor(life, b));
+        Node *n10 = keep(life, successor(life, join(life, a->sw, a->se, c->nw, c->ne)));
+        Node *n11 = keep(life, successor(life, join(life, a->se, b->sw, c->ne, d->nw)));
+        Node *n12 = keep(life, successor(life, join(life, b->sw, b->se, d->nw, d->ne)));
+        Node *n20 = keep(life, successor(life, c));
+        Node *n21 = keep(life, successor(life, join(life, c->ne, d->nw, c->se, d->sw)));
+        Node *n22 = keep(life, successor(life, d));
+
+        Node *nw, *ne, *sw, *se;
+        if (node->level - 2 <= life->stepLog) {
+            nw = keep(life, successor(life, join(life, n00, n01, n10, n11)));
+            ne = keep(life, successor(life, join(life, n01, n02, n11, n12)));
+            sw = keep(life, successor(life, join(life, n10, n11, n20, n21)));
+            se = successor(life, join(life, n11, n12, n21, n22));
+        } else {
+            nw = keep(life, centerOf(life, n00, n01, n10, n11));
+            ne = keep(life, centerOf(life, n01, n02, n11, n12));
+            sw = keep(life, centerOf(life, n10, n11, n20, n21));
+            se = centerOf(life, n11, n12, n21, n22);
+        }
+        node->result = join(life, nw, ne, sw, se);
+    }
+    life->stackCount = top;
+    return node->result;
+}
+
+static Node *lookupImport(HashLife *life, uint64_t key, ImportEntry **entry) {
+    size_t slot = (size_t) ((key * 0x9E3779B97F4A7C15ULL) >> 17) & (life->memoCapacity - 1);
+    while (life->memo[slot].key != 0 && life->memo[slot].key != key) slot = (slot + 1) & (life->memoCapacity - 1);
+    *entry = &life->memo[slot];
+    return life->memo[slot].key == key ? life->memo[slot].node : NULL;
+}
+
+static void growImport(HashLife *life) {
+    ImportEntry *memo = life->memo;
+    size_t capacity = life->memoCapacity;
+    life->memoCapacity *= 2;
+    life->memo = calloc(life->memoCapacity, sizeof(ImportEntry));
+    for (size_t i = 0; i < capacity; i++) {
+        if (memo[i].key == 0) continue;
+        ImportEntry *entry;
+        lookupImport(life, memo[i].key, &entry);
+        *entry = memo[i];
+    }
+    free(memo);
+}
+
+/**
+ * The node of the given level whose top-left cell is (x, y) of the periodically repeated grid. Its content only
+ * depends on the position modulo the grid size, so the many copies of the grid in a large universe are built once.
+ */
+static Node *importNode(HashLife *life, int level, int64_t x, int64_t y) {
+    x = ((x % life->w) + life->w) % life->w;
+    y = ((y % life->h) + life->h) % life->h;
+    if (level == 0) {
+        uint64_t word = life->field[y * life->words + x / WORD_BITS];
+        return (word >> (x % WORD_BITS)) & 1 ? &aliveCell : &deadCell;
+    }
+
+    ImportEntry *entry = NULL;
+    uint64_t key = 0;
+    if (level >= IMPORT_MEMO_LEVEL) {
+        key = ((uint64_t) level << 56 | (uint64_t) x << 28 | (uint64_t) y) + 1;
+        Node *node = lookupImport(life, key, &entry);
+        if (node != NULL) return node;
+    }
+
+    int64_t half = (int64_t) 1 << (level - 1);
+    size_t top = life->stackCount;
+    Node *nw = keep(life, importNode(life, level - 1, x, y));
+    Node *ne = keep(life, importNode(life, level - 1, x + half, y));
+    Node *sw = keep(life, importNode(life, level - 1, x, y + half));
+    Node *se = importNode(life, level - 1, x + half, y + half);
+    Node *node = join(life, nw, ne, sw, se);
+    life->stackCount = top;
+
+    if (level >= IMPORT_MEMO_LEVEL) {
+        // the recursion may have grown the table, the slot has to be looked up again
+        lookupImport(life, key, &entry);
+        entry->key = key;
+        entry->node = node;
+        if (++life->memoCount * 2 > life->memoCapacity) growImport(life);
+    }
+    return node;
+}
+
+/**
+ * Sets the alive cells of a node whose top-left cell is (x, y) in the packed grid, cells outside the grid are dropped.
+ */
+static void exportNode(const Node *node, int64_t x, int64_t y, uint64_t *next, int w, int h, int words) {
+    if (!node->alive || x >= w || y >= h) return;
+    if (node->level == 0) {
+        next[y * words + x / WORD_BITS] |= (uint64_t) 1 << (x % WORD_BITS);
+        return;
+    }
+    int64_t half = (int64_t) 1 << (node->level - 1);
+    exportNode(node->nw, x, y, next, w, h, words);
+    exportNode(node->ne, x + half, y, next, w, h, words);
+    exportNode(node->sw, x, y + half, next, w, h, words);
+    exportNode(node->se, x + half, y + half, next, w, h, words);
+}
+
+HashLife *hashLifeCreate(int stepLog, size_t memoryBytes, GolRule rule) {
+    HashLife *life = calloc(1, sizeof(HashLife));
+    life->stepLog = stepLog;
+    life->memoryBytes = memoryBytes;
+    buildBase(life, rule);
+    life->capacity = MIN_CAPACITY;
+    life->table = calloc(life->capacity, sizeof(Node *));
+    life->memoCapacity = 1 << 12;
+    life->memo = calloc(life->memoCapacity, sizeof(ImportEntry));
+    return life;
+}
+
+void hashLifeAdvance(HashLife *life, const uint64_t *field, uint64_t *next, int w, int h) {
+    // the universe has to hold the grid in the center half of its result and advance 2^stepLog generations
+    int gridLevel = 0;
+    while (((int64_t) 1 << gridLevel) < w || ((int64_t) 1 << gridLevel) < h) gridLevel++;
+    int level = gridLevel + 1 > life->stepLog + 2 ? gridLevel + 1 : life->stepLog + 2;
+    if (level < 3) level = 3;
+
+    life->field = field;
+    life->w = w;
+    life->h = h;
+    life->words = calcWords(w);
+    memset(life->memo, 0, life->memoCapacity * sizeof(ImportEntry));
+    life->memoCount = 0;
+
+    // the result of the root covers the cells 0 .. 2^(level-1)-1 in both directions
+    int64_t origin = -((int64_t) 1 << (level - 2));
+    Node *root = importNode(life, level, origin, origin);
+    Node *result = successor(life, root);
+
+    memset(next, 0, (size_t) life->words * h * sizeof(uint64_t));
+    exportNode(result, 0, 0, next, w, h, life->words);
+}
+
+size_t hashLifeNodes(const HashLife *life) {
+    return life->count;
+}
+
+long hashLifeCollections(const HashLife *life) {
+    return life->collections;
+}
+
+void hashLifeFree(HashLife *life) {
+    while (life->chunks != NULL) {
+        NodeChunk *next = life->chunks->next;
+        free(life->chunks);
+        life->chunks = next;
+    }
+    free(life->table);
+    free(life->memo);
+    free(life->stack);
+    free(life);
+}
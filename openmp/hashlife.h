@@ -0,0 +1,40 @@
+#ifndef HASHLIFE_H
+#define HASHLIFE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "../simd/gol_kernel.h"
+
+/**
+ * HashLife engine for long runs: the universe is a hash-consed quadtree, every macro-cell memoizes its result, so
+ * repeated structure in space and time is computed only once and one step advances 2^k generations.
+ *
+ * The grid is the same bit-packed periodic grid the brute-force evolve works on (cell x of row y is bit x % 64 of word
+ * y * calcWords(w) + x / 64). A step builds the quadtree from the periodic tiling of the grid, which stays cheap
+ * because tiles repeat, so the result is exact on the torus.
+ */
+typedef struct HashLife HashLife;
+
+/**
+ * Creates an engine that advances 2^stepLog generations per step under the rule. Once the nodes and their table would
+ * take more than memoryBytes, the nodes the running step no longer needs are collected together with their memoized
+ * results, also in the middle of a step.
+ */
+HashLife *hashLifeCreate(int stepLog, size_t memoryBytes, GolRule rule);
+
+/**
+ * Advances the w x h grid `field` by 2^stepLog generations and writes the result to `next`.
+ */
+void hashLifeAdvance(HashLife *life, const uint64_t *field, uint64_t *next, int w, int h);
+
+/**
+ * Number of nodes currently held and number of garbage collections so far.
+ */
+size_t hashLifeNodes(const HashLife *life);
+
+long hashLifeCollections(const HashLife *life);
+
+void hashLifeFree(HashLife *life);
+
+#endif
@@ -1,11 +1,13 @@
 import os
 import re
 import csv
+import json
 import sys
 import platform
 import itertools
 import subprocess as sp
 import multiprocessing as mp
+from statistics import mean
 
 if __name__ == "__main__":
     cpu_count = mp.cpu_count()
@@ -20,27 +22,34 @@ if __name__ == "__main__":
     y_threads = x_threads
     threads = [x for x in itertools.product(x_threads, y_threads) if x[0]*x[1] <= cpu_count]
     threads.sort(key=lambda t: t[0]*t[1])
+    # grid placement before (master thread allocates everything) and after (pages local to the threads that use them)
+    placements = ["master", "local"]
 
     # get arguments
     time_steps = int(sys.argv[1]) if len(sys.argv) > 1 and sys.argv[1].isdigit() else 100
     iterations = int(sys.argv[2]) if len(sys.argv) > 2 and sys.argv[1].isdigit() else 5
 
-    # list of tuples (PC, #Cores, grid-X, grid-Y, #threads, #threads-X, #threads-Y, thread-Width, thread-Height, times)
-    # times = list of elapsed seconds 
-    header_row = ("PC", "#Cores", "grid-X", "grid-Y", "#threads", "#threads-X", "#threads-Y", "thread-Width", "thread-Height", "times")
+    # list of tuples (PC, #Cores, grid-X, grid-Y, #threads, #threads-X, #threads-Y, thread-Width, thread-Height, placement, times, AVG(time), ns/cell, AVG(cells/s), AVG(imbalance), AVG(generations))
+    # times = list of elapsed seconds, ns/cell = average time per cell update
+    # cells/s and imbalance come from the program's timing report of the time loop, see --timing
+    header_row = ("PC", "#Cores", "grid-X", "grid-Y", "#threads", "#threads-X", "#threads-Y", "thread-Width", "thread-Height", "placement", "times", "AVG(time)", "ns/cell", "AVG(cells/s)", "AVG(imbalance)", "AVG(generations)")
     result_list = []
 
     for total_width, total_height in grid_sizes:
         print("Grid Size:", total_width, "x", total_height)
         
-        for thread_count_x, thread_count_y in threads:
-            print("Threads:", thread_count_x * thread_count_y, "X:", thread_count_x, "Y:", thread_count_y)
+        for (thread_count_x, thread_count_y), placement in itertools.product(threads, placements):
+            print("Threads:", thread_count_x * thread_count_y, "X:", thread_count_x, "Y:", thread_count_y, "Placement:", placement)
             thread_width = total_width // thread_count_x
             thread_height = total_height // thread_count_y
 
             times = []
+            throughputs = []
+            imbalances = []
+            generations = []
+            ns_per_cells = []
             for i in range(iterations):
-                result = sp.run(["time", "../gameoflife", str(time_steps), str(thread_width), str(thread_height), str(thread_count_x), str(thread_count_y)], stderr=sp.PIPE)
+                result = sp.run(["time", "../gameoflife", "--placement=" + placement, "--timing=timing.json", str(time_steps), str(thread_width), str(thread_height), str(thread_count_x), str(thread_count_y)], stderr=sp.PIPE)
                 
                 elapsed = str(result.stderr.split()[2])
                 time_search = re.search("([0-9]+):([0-9]+).([0-9]+)", elapsed)
@@ -54,7 +63,14 @@ if __name__ == "__main__":
                 print("ITERATION", i, "Elapsed time:", minutes,"minutes", seconds, "seconds", milis, "miliseconds")
                 seconds_total = int(minutes) * 60 + int(seconds) + int(milis)/1000
                 times.append(seconds_total)
-            result_tuple = (pc_name, cpu_count, total_width, total_height, thread_count_x * thread_count_y, thread_count_x, thread_count_y, thread_width, thread_height, times)
+                with open("timing.json") as timing_file:
+                    timing = json.load(timing_file)
+                throughputs.append(timing["cells_per_second"])
+                imbalances.append(timing["imbalance"])
+                # a steady grid ends the run early, only the generations it computed count
+                generations.append(timing["generations"])
+                ns_per_cells.append(times[-1] * 1e9 / (total_width * total_height * generations[-1]))
+            result_tuple = (pc_name, cpu_count, total_width, total_height, thread_count_x * thread_count_y, thread_count_x, thread_count_y, thread_width, thread_height, placement, times, mean(times), mean(ns_per_cells), mean(throughputs), mean(imbalances), mean(generations))
             result_list.append(result_tuple)
     
 with open("results_"+pc_name+".csv", "w") as out:
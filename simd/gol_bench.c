@@ -0,0 +1,585 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+#include <unistd.h>
+#include <getopt.h>
+
+#include <omp.h>
+#ifdef GOL_BENCH_MPI
+#include <mpi/mpi.h>
+#endif
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#endif
+
+#include "gol_kernel.h"
+
+/**
+ * Micro-benchmark of the evolve kernels, independent of the game around them: no halo exchange, no steady-state check,
+ * no output. Every combination of kernel, mode, rule, grid size, tile shape, thread count and temporal blocking is run
+ * with warm-up and repeated trials, the median trial is reported as ns per cell update, as GB/s of grid streamed and
+ * with the hardware counters of perf_event_open. Built with GOL_BENCH_MPI every rank runs the same benchmark on its band
+ * of the grid at the same time, so the ranks compete for the memory bandwidth like in the MPI build.
+ *
+ * A generation is computed the way the games do it: the grid is cut into px x py tiles that the threads take with a
+ * dynamic schedule and compute row by row; with temporal blocking every tile is cut into L2-sized blocks that are
+ * copied out with a halo and advanced by k generations at once. The grid edges count as dead cells.
+ *
+ * The results are written as CSV; given a baseline written before, every configuration that got slower than the
+ * tolerance allows is flagged and the exit status is 1.
+ */
+
+#define WORD_BITS 64
+#define calcWords(width)  (((width) + WORD_BITS - 1) / WORD_BITS)
+#define calcIndex(width, x, y)  ((y)*(width) + (x))
+
+// a trial computes at least this many cell updates, at least one temporal block of generations
+#define TRIAL_CELLS (1L << 27)
+// baseline keys: kernel,mode,rule,ranks,threads,size,tiles,temporal
+#define KEY_SIZE 128
+#define MAX_LIST 32
+
+int rank = 0, ranks = 1;
+
+// hardware counters, summed over the threads (and ranks) of a trial
+#define COUNTERS 4
+static const char *counterNames[COUNTERS] = {"cycles", "instructions", "L1d read misses", "LLC misses"};
+
+typedef struct {
+    int from, to;       ///< words of the rows
+    int y0, y1;         ///< rows
+} Unit;
+
+typedef struct {
+    GolKernel kernel;
+    GolMode mode;
+    GolRule rule;
+    int size;           ///< grid edge in cells, each rank computes size / ranks rows of it
+    int px, py;         ///< tiles
+    int threads;
+    int temporal;
+} Config;
+
+typedef struct {
+    double seconds;     ///< median trial
+    long generations;   ///< per trial
+    double counts[COUNTERS];    ///< per trial, NAN if the counter is not available
+} Result;
+
+#ifdef __linux__
+static int openCounter(int counter) {
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.disabled = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    switch (counter) {
+        case 0: attr.type = PERF_TYPE_HARDWARE; attr.config = PERF_COUNT_HW_CPU_CYCLES; break;
+        case 1: attr.type = PERF_TYPE_HARDWARE; attr.config = PERF_COUNT_HW_INSTRUCTIONS; break;
+        case 2:
+            attr.type = PERF_TYPE_HW_CACHE;
+            attr.config = PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                          (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+            break;
+        default: attr.type = PERF_TYPE_HARDWARE; attr.config = PERF_COUNT_HW_CACHE_MISSES; break;
+    }
+    // the calling thread on any CPU
+    return syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+}
+#else
+static int openCounter(int counter) {
+    return -1;
+}
+#endif
+
+/**
+ * Opens the counters of the calling thread and starts them, a counter that cannot be opened stays at -1.
+ */
+static void startCounters(int *fds) {
+    for (int i = 0; i < COUNTERS; i++) {
+        fds[i] = openCounter(i);
+#ifdef __linux__
+        if (fds[i] >= 0) ioctl(fds[i], PERF_EVENT_IOC_ENABLE, 0);
+#endif
+    }
+}
+
+/**
+ * Stops and closes the counters of the calling thread and adds them to counts, a counter missing on any thread is NAN.
+ */
+static void stopCounters(const int *fds, double *counts) {
+    for (int i = 0; i < COUNTERS; i++) {
+        long long value = 0;
+#ifdef __linux__
+        if (fds[i] >= 0) ioctl(fds[i], PERF_EVENT_IOC_DISABLE, 0);
+#endif
+        int valid = fds[i] >= 0 && read(fds[i], &value, sizeof(value)) == sizeof(value);
+        if (fds[i] >= 0) close(fds[i]);
+#pragma omp atomic
+        counts[i] += valid ? (double) value : NAN;
+    }
+}
+
+/**
+ * Cuts the cols x rows grid (words per row) into px x py tiles and, with temporal blocking, the tiles into L2-sized
+ * blocks. Returns the number of units.
+ */
+static int cutUnits(int words, int rows, int px, int py, int temporal, Unit **units) {
+    int capacity = px * py;
+    int count = 0;
+    *units = malloc(capacity * sizeof(Unit));
+    for (int ty = 0; ty < py; ty++) {
+        for (int tx = 0; tx < px; tx++) {
+            int from = (int) ((long) words * tx / px), to = (int) ((long) words * (tx + 1) / px);
+            int y0 = (int) ((long) rows * ty / py), y1 = (int) ((long) rows * (ty + 1) / py);
+            if (from == to || y0 == y1) continue;
+            int blockWidth = (to - from) * WORD_BITS, blockHeight = y1 - y0;
+            if (temporal > 1) golBlockSize(blockWidth, blockHeight, temporal, &blockWidth, &blockHeight);
+            int blockWords = calcWords(blockWidth);
+            for (int y = y0; y < y1; y += blockHeight) {
+                for (int x = from; x < to; x += blockWords) {
+                    if (count == capacity) {
+                        capacity *= 2;
+                        *units = realloc(*units, capacity * sizeof(Unit));
+                    }
+                    Unit unit = {x, x + blockWords < to ? x + blockWords : to,
+                                 y, y + blockHeight < y1 ? y + blockHeight : y1};
+                    (*units)[count++] = unit;
+                }
+            }
+        }
+    }
+    return count;
+}
+
+/**
+ * One generation of a unit, row by row.
+ */
+static void evolveUnit(const uint64_t *current, uint64_t *next, const uint64_t *dead, int words, int rows,
+                       const Unit *unit, GolRowKernel rowKernel) {
+    for (int y = unit->y0; y < unit->y1; y++) {
+        const uint64_t *above = y > 0 ? &current[calcIndex(words, 0, y - 1)] : dead;
+        const uint64_t *below = y + 1 < rows ? &current[calcIndex(words, 0, y + 1)] : dead;
+        golEvolveRow(rowKernel, above, &current[calcIndex(words, 0, y)], below, &next[calcIndex(words, 0, y)],
+                     unit->from, unit->to, words);
+    }
+}
+
+/**
+ * `generations` generations of a unit at once: the unit and a halo of `generations` cells are copied into a block,
+ * advanced and the unit's words written back.
+ */
+static void advanceUnit(const uint64_t *current, uint64_t *next, int words, int rows, const Unit *unit, int generations,
+                        uint64_t *block, uint64_t *scratch, GolRowKernel rowKernel) {
+    int haloWords = calcWords(generations);
+    int blockWords = unit->to - unit->from + 2 * haloWords;
+    int blockRows = unit->y1 - unit->y0 + 2 * generations;
+    for (int r = 0; r < blockRows; r++) {
+        int y = unit->y0 - generations + r;
+        uint64_t *target = &block[calcIndex(blockWords, 0, r)];
+        if (y < 0 || y >= rows) {
+            memset(target, 0, blockWords * sizeof(uint64_t));
+            continue;
+        }
+        golLoadRow(target, &current[calcIndex(words, 0, y)], (unit->from - haloWords) * WORD_BITS, blockWords, words);
+    }
+    uint64_t *result = golAdvanceBlock(block, scratch, blockWords, blockRows, generations, rowKernel);
+    for (int y = unit->y0; y < unit->y1; y++) {
+        memcpy(&next[calcIndex(words, unit->from, y)],
+               &result[calcIndex(blockWords, haloWords, y - unit->y0 + generations)],
+               (unit->to - unit->from) * sizeof(uint64_t));
+    }
+}
+
+static int compareDoubles(const void *a, const void *b) {
+    double x = *(const double *) a, y = *(const double *) b;
+    return (x > y) - (x < y);
+}
+
+static Result runConfig(const Config *config, int warmup, int trials) {
+    int cols = config->size;
+    // strong scaling over the ranks: every rank computes its band of the rows
+    int rows = (int) ((long) config->size * (rank + 1) / ranks - (long) config->size * rank / ranks);
+    int words = calcWords(cols);
+    GolRowKernel rowKernel = golRowKernel(config->kernel, config->mode, config->rule);
+    Unit *units;
+    int unitCount = cutUnits(words, rows, config->px, config->py, config->temporal, &units);
+    int blockWords = 0, blockRows = 0;
+    for (int i = 0; i < unitCount; i++) {
+        if (units[i].to - units[i].from > blockWords) blockWords = units[i].to - units[i].from;
+        if (units[i].y1 - units[i].y0 > blockRows) blockRows = units[i].y1 - units[i].y0;
+    }
+    blockWords += 2 * calcWords(config->temporal);
+    blockRows += 2 * config->temporal;
+
+    Result result;
+    long cells = (long) config->size * config->size;
+    long steps = (TRIAL_CELLS + cells * config->temporal - 1) / (cells * config->temporal);
+    result.generations = steps * config->temporal;
+
+    uint64_t *current = malloc((size_t) words * rows * sizeof(uint64_t));
+    uint64_t *next = calloc((size_t) words * rows, sizeof(uint64_t));
+    uint64_t *dead = calloc(words, sizeof(uint64_t));
+    srand(42 * 0x815 + rank);
+    for (long i = 0; i < (long) words * rows; i++) {
+        uint64_t word = 0;
+        for (int bit = 0; bit < WORD_BITS; bit++) {
+            if (rand() < RAND_MAX / 10) word |= (uint64_t) 1 << bit;
+        }
+        current[i] = word;
+    }
+    if (cols % WORD_BITS != 0) {
+        uint64_t mask = ~(uint64_t) 0 >> (WORD_BITS - cols % WORD_BITS);
+        for (int y = 0; y < rows; y++) current[calcIndex(words, words - 1, y)] &= mask;
+    }
+
+    double *seconds = malloc(trials * sizeof(double));
+    double (*counts)[COUNTERS] = calloc(trials, sizeof(*counts));
+    for (int trial = -warmup; trial < trials; trial++) {
+        double *trialCounts = trial >= 0 ? counts[trial] : NULL;
+#ifdef GOL_BENCH_MPI
+        MPI_Barrier(MPI_COMM_WORLD);
+#endif
+        double start = omp_get_wtime();
+#pragma omp parallel num_threads(config->threads)
+        {
+            int fds[COUNTERS];
+            uint64_t *block = NULL, *scratch = NULL;
+            if (config->temporal > 1) {
+                block = malloc((size_t) blockWords * blockRows * sizeof(uint64_t));
+                scratch = malloc((size_t) blockWords * blockRows * sizeof(uint64_t));
+            }
+            if (trialCounts != NULL) startCounters(fds);
+            for (long step = 0; step < steps; step++) {
+#pragma omp for schedule(dynamic)
+                for (int i = 0; i < unitCount; i++) {
+                    if (config->temporal > 1) {
+                        advanceUnit(current, next, words, rows, &units[i], config->temporal, block, scratch, rowKernel);
+                    } else {
+                        evolveUnit(current, next, dead, words, rows, &units[i], rowKernel);
+                    }
+                }
+#pragma omp single
+                {
+                    uint64_t *temp = current;
+                    current = next;
+                    next = temp;
+                }
+            }
+            if (trialCounts != NULL) stopCounters(fds, trialCounts);
+            free(block);
+            free(scratch);
+        }
+        double elapsed = omp_get_wtime() - start;
+#ifdef GOL_BENCH_MPI
+        // a trial takes as long as the slowest rank, the counters of all ranks are summed
+        MPI_Allreduce(MPI_IN_PLACE, &elapsed, 1, MPI_DOUBLE, MPI_MAX, MPI_COMM_WORLD);
+        if (trialCounts != NULL) {
+            MPI_Allreduce(MPI_IN_PLACE, trialCounts, COUNTERS, MPI_DOUBLE, MPI_SUM, MPI_COMM_WORLD);
+        }
+#endif
+        if (trial >= 0) seconds[trial] = elapsed;
+    }
+
+    // the median trial and its counters
+    double *sorted = malloc(trials * sizeof(double));
+    memcpy(sorted, seconds, trials * sizeof(double));
+    qsort(sorted, trials, sizeof(double), compareDoubles);
+    result.seconds = sorted[trials / 2];
+    int median = 0;
+    while (seconds[median] != result.seconds) median++;
+    memcpy(result.counts, counts[median], sizeof(result.counts));
+
+    free(sorted);
+    free(seconds);
+    free(counts);
+    free(current);
+    free(next);
+    free(dead);
+    free(units);
+    return result;
+}
+
+static void configKey(const Config *config, char *key) {
+    char rule[32];
+    golFormatRule(config->rule, rule, sizeof(rule));
+    snprintf(key, KEY_SIZE, "%s,%s,%s,%d,%d,%d,%dx%d,%d", golKernelName(config->kernel), golModeName(config->mode),
+             rule, ranks, config->threads, config->size, config->px, config->py, config->temporal);
+}
+
+/**
+ * ns per cell update of the configuration in a baseline file, 0 if it is not listed.
+ */
+static double baselineNs(const char *fileName, const char *key) {
+    FILE *fp = fileName != NULL ? fopen(fileName, "r") : NULL;
+    if (fp == NULL) return 0;
+    char line[512];
+    double ns = 0;
+    size_t length = strlen(key);
+    while (fgets(line, sizeof(line), fp) != NULL) {
+        long generations;
+        // the key is followed by the generations and the ns per cell
+        if (strncmp(line, key, length) == 0 && line[length] == ',' &&
+            sscanf(line + length, ",%ld,%lf", &generations, &ns) == 2) {
+            break;
+        }
+        ns = 0;
+    }
+    fclose(fp);
+    return ns;
+}
+
+/**
+ * Parses a comma-separated list of positive numbers, returns how many were read.
+ */
+static int parseList(const char *text, int *values) {
+    int count = 0;
+    for (const char *p = text; *p != '\0' && count < MAX_LIST; ) {
+        int value = atoi(p);
+        if (value > 0) values[count++] = value;
+        p += strcspn(p, ",");
+        if (*p == ',') p++;
+    }
+    return count;
+}
+
+/**
+ * Parses a comma-separated list of rules, returns how many were read or -1 on a rule that is not supported.
+ */
+static int parseRules(const char *text, GolRule *rules) {
+    int count = 0;
+    for (const char *p = text; *p != '\0' && count < MAX_LIST; ) {
+        char rule[32];
+        int length = (int) strcspn(p, ",");
+        snprintf(rule, sizeof(rule), "%.*s", length, p);
+        if (golParseRule(rule, &rules[count++]) != 0) return -1;
+        p += length;
+        if (*p == ',') p++;
+    }
+    return count;
+}
+
+/**
+ * Parses a comma-separated list of tile shapes "<px>x<py>", returns how many were read.
+ */
+static int parseTiles(const char *text, int *px, int *py) {
+    int count = 0;
+    for (const char *p = text; *p != '\0' && count < MAX_LIST; ) {
+        if (sscanf(p, "%dx%d", &px[count], &py[count]) == 2 && px[count] > 0 && py[count] > 0) count++;
+        p += strcspn(p, ",");
+        if (*p == ',') p++;
+    }
+    return count;
+}
+
+int main(int c, char **v) {
+#ifdef GOL_BENCH_MPI
+    int provided;
+    MPI_Init_thread(&c, &v, MPI_THREAD_FUNNELED, &provided);
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &ranks);
+#endif
+    char *kernelNames = NULL;
+    char *modeNames = NULL;
+    char *ruleList = NULL;
+    char *sizeList = NULL;
+    char *tileList = NULL;
+    char *threadList = NULL;
+    char *temporalList = NULL;
+    int warmup = 1;
+    int trials = 5;
+    char *baseline = NULL;
+    char *output = NULL;
+    double tolerance = 10;
+
+    static struct option options[] = {
+            {"simd", required_argument, NULL, 's'},
+            {"mode", required_argument, NULL, 'm'},
+            {"rules", required_argument, NULL, 'R'},
+            {"sizes", required_argument, NULL, 'n'},
+            {"tiles", required_argument, NULL, 'p'},
+            {"threads", required_argument, NULL, 'T'},
+            {"temporal", required_argument, NULL, 'k'},
+            {"warmup", required_argument, NULL, 'w'},
+            {"trials", required_argument, NULL, 'r'},
+            {"baseline", required_argument, NULL, 'b'},
+            {"output", required_argument, NULL, 'o'},
+            {"tolerance", required_argument, NULL, 'x'},
+            {NULL, 0, NULL, 0}
+    };
+    int option;
+    while ((option = getopt_long(c, v, "s:m:R:n:p:T:k:w:r:b:o:x:", options, NULL)) != -1) {
+        switch (option) {
+            case 's': kernelNames = optarg; break;  ///< read kernels (scalar, sse2, avx2, avx512), default: all
+            case 'm': modeNames = optarg; break;    ///< read modes (stencil, rowsum), default: both
+            case 'R': ruleList = optarg; break;     ///< read rules in B/S notation, default: B3/S23
+            case 'n': sizeList = optarg; break;     ///< read grid edges in cells
+            case 'p': tileList = optarg; break;     ///< read tile shapes <px>x<py>, default: all with px * py = threads
+            case 'T': threadList = optarg; break;   ///< read thread counts
+            case 'k': temporalList = optarg; break; ///< read generations per temporal block
+            case 'w': warmup = atoi(optarg); break; ///< read warm-up trials
+            case 'r': trials = atoi(optarg); break; ///< read measured trials
+            case 'b': baseline = optarg; break;     ///< read baseline CSV to compare against
+            case 'o': output = optarg; break;       ///< read CSV file the results are appended to
+            case 'x': tolerance = atof(optarg); break;  ///< read slowdown in percent flagged as a regression
+            default:
+#ifdef GOL_BENCH_MPI
+                MPI_Finalize();
+#endif
+                return -1;
+        }
+    }
+    if (warmup < 0) warmup = 0;
+    if (trials <= 0) trials = 5;
+
+    // L1-resident up to DRAM-sized grids: 2 x 8 KiB, 2 x 128 KiB, 2 x 2 MiB and 2 x 32 MiB
+    int sizes[MAX_LIST] = {256, 1024, 4096, 16384};
+    int sizeCount = sizeList != NULL ? parseList(sizeList, sizes) : 4;
+    int threads[MAX_LIST];
+    int threadCount = 0;
+    if (threadList != NULL) {
+        threadCount = parseList(threadList, threads);
+    } else {
+        // powers of two up to all cores and all cores
+        int cores = omp_get_max_threads();
+        for (int t = 1; t < cores && threadCount < MAX_LIST - 1; t *= 2) threads[threadCount++] = t;
+        threads[threadCount++] = cores;
+    }
+    GolRule rules[MAX_LIST] = {GOL_RULE_CONWAY};
+    int ruleCount = ruleList != NULL ? parseRules(ruleList, rules) : 1;
+    if (ruleCount <= 0) {
+        if (rank == 0) printf("ERROR unsupported rule in %s\n", ruleList);
+#ifdef GOL_BENCH_MPI
+        MPI_Finalize();
+#endif
+        return -1;
+    }
+    int temporal[MAX_LIST] = {1, 8};
+    int temporalCount = temporalList != NULL ? parseList(temporalList, temporal) : 2;
+    int tilesX[MAX_LIST], tilesY[MAX_LIST];
+    int tileCount = tileList != NULL ? parseTiles(tileList, tilesX, tilesY) : 0;
+
+    GolKernel kernels[GOL_KERNEL_COUNT];
+    int kernelCount = 0;
+    for (GolKernel kernel = 0; kernel < GOL_KERNEL_COUNT; kernel++) {
+        if (golKernelSupported(kernel) &&
+            (kernelNames == NULL || strstr(kernelNames, golKernelName(kernel)) != NULL)) {
+            kernels[kernelCount++] = kernel;
+        }
+    }
+    GolMode modes[GOL_MODE_COUNT];
+    int modeCount = 0;
+    for (GolMode mode = 0; mode < GOL_MODE_COUNT; mode++) {
+        if (modeNames == NULL || strstr(modeNames, golModeName(mode)) != NULL) modes[modeCount++] = mode;
+    }
+
+    FILE *csv = NULL;
+    if (rank == 0 && output != NULL) {
+        csv = fopen(output, "a");
+        if (csv == NULL) {
+            printf("ERROR could not write %s\n", output);
+#ifdef GOL_BENCH_MPI
+            MPI_Abort(MPI_COMM_WORLD, 1);
+#endif
+            return -1;
+        }
+        if (ftell(csv) == 0) {
+            fprintf(csv, "kernel,mode,rule,ranks,threads,size,tiles,temporal,generations,ns_per_cell,gb_per_s,ipc,"
+                         "l1d_misses_per_kcell,llc_misses_per_kcell\n");
+        }
+    }
+    if (rank == 0) {
+        printf("Ranks: %d, warm-up: %d, trials: %d, counters:", ranks, warmup, trials);
+        for (int i = 0; i < COUNTERS; i++) {
+            int fd = openCounter(i);
+            printf(" %s%s", counterNames[i], fd >= 0 ? "" : " (n/a)");
+            if (fd >= 0) close(fd);
+        }
+        printf("\n%-8s %-8s %-13s %7s %6s %7s %8s %10s %8s %6s %9s %9s %s\n", "kernel", "mode", "rule", "threads",
+               "size", "tiles", "temporal", "ns/cell", "GB/s", "IPC", "L1d/kc", "LLC/kc", "baseline");
+    }
+
+    int regressions = 0;
+    for (int ti = 0; ti < threadCount; ti++) {
+        // the tile shapes px x py with px * py = threads unless given
+        int px[MAX_LIST], py[MAX_LIST];
+        int shapes = 0;
+        if (tileCount > 0) {
+            shapes = tileCount;
+            memcpy(px, tilesX, sizeof(px));
+            memcpy(py, tilesY, sizeof(py));
+        } else {
+            for (int x = 1; x <= threads[ti] && shapes < MAX_LIST; x++) {
+                if (threads[ti] % x == 0) {
+                    px[shapes] = x;
+                    py[shapes++] = threads[ti] / x;
+                }
+            }
+        }
+        for (int si = 0; si < sizeCount; si++) {
+            for (int shape = 0; shape < shapes; shape++) {
+                for (int ki = 0; ki < temporalCount; ki++) {
+                    for (int kernel = 0; kernel < kernelCount; kernel++) {
+                        for (int mode = 0; mode < modeCount; mode++) {
+                            for (int ri = 0; ri < ruleCount; ri++) {
+                                Config config = {kernels[kernel], modes[mode], rules[ri], sizes[si], px[shape],
+                                                 py[shape], threads[ti], temporal[ki]};
+                                if (config.size / ranks < config.py || calcWords(config.size) < config.px) continue;
+                                Result result = runConfig(&config, warmup, trials);
+                                if (rank != 0) continue;
+
+                                double updates = (double) config.size * config.size * result.generations;
+                                double ns = result.seconds * 1e9 / updates;
+                                // the grid is read and written once per generation, or once per temporal block
+                                double bytes = 2.0 * calcWords(config.size) * sizeof(uint64_t) * config.size *
+                                               (result.generations / config.temporal);
+                                double gbs = bytes / result.seconds / 1e9;
+                                double ipc = result.counts[1] / result.counts[0];
+                                double l1d = result.counts[2] * 1000 / updates;
+                                double llc = result.counts[3] * 1000 / updates;
+
+                                char key[KEY_SIZE];
+                                configKey(&config, key);
+                                double before = baselineNs(baseline, key);
+                                char verdict[64] = "-";
+                                if (before > 0) {
+                                    double change = 100 * (ns / before - 1);
+                                    int regression = change > tolerance;
+                                    regressions += regression;
+                                    snprintf(verdict, sizeof(verdict), "%+.1f%%%s", change,
+                                             regression ? " REGRESSION" : "");
+                                }
+                                char tiles[32], rule[32];
+                                snprintf(tiles, sizeof(tiles), "%dx%d", config.px, config.py);
+                                golFormatRule(config.rule, rule, sizeof(rule));
+                                printf("%-8s %-8s %-13s %7d %6d %7s %8d %10.4f %8.2f %6.2f %9.2f %9.2f %s\n",
+                                       golKernelName(config.kernel), golModeName(config.mode), rule, config.threads,
+                                       config.size, tiles, config.temporal, ns, gbs, ipc, l1d, llc, verdict);
+                                fflush(stdout);
+                                if (csv != NULL) {
+                                    fprintf(csv, "%s,%ld,%.6g,%.6g,%.6g,%.6g,%.6g\n", key, result.generations, ns,
+                                            gbs, ipc, l1d, llc);
+                                }
+                            }
+                        }
+                    }
+                }
+            }
+        }
+    }
+    if (csv != NULL) fclose(csv);
+    if (rank == 0 && baseline != NULL) {
+        if (access(baseline, R_OK) != 0) printf("No baseline %s to compare against\n", baseline);
+        else printf("Regressions against %s: %d (tolerance %.1f%%)\n", baseline, regressions, tolerance);
+    }
+#ifdef GOL_BENCH_MPI
+    MPI_Bcast(&regressions, 1, MPI_INT, 0, MPI_COMM_WORLD);
+    MPI_Finalize();
+#endif
+    return regressions > 0 ? 1 : 0;
+}
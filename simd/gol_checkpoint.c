@@ -0,0 +1,140 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <sys/types.h>
+
+#include "gol_kernel.h"
+#include "gol_checkpoint.h"
+
+#define WORD_BITS 64
+#define calcWords(width)  (((width) + WORD_BITS - 1) / WORD_BITS)
+#define calcIndex(width, x, y)  ((y)*(width) + (x))
+
+void golCheckpointFileName(char *out, int size, const char *prefix, uint64_t pieces, int piece) {
+    if (pieces == 1) snprintf(out, size, "%s.gol", prefix);
+    else snprintf(out, size, "%s-%03d.gol", prefix, piece);
+}
+
+uint64_t golCheckpointRowOffset(uint64_t width, uint64_t row) {
+    return sizeof(GolCheckpoint) + row * calcWords(width) * sizeof(uint64_t);
+}
+
+void golCheckpointPack(const uint64_t *grid, int words, int x, int y, int cols, int rows, uint64_t *out) {
+    int outWords = calcWords(cols);
+    memset(out, 0, (size_t) outWords * rows * sizeof(uint64_t));
+    for (int r = 0; r < rows; r++) {
+        const uint64_t *row = &grid[calcIndex(words, 0, y + r)];
+        for (int c = 0; c < cols; c += WORD_BITS) {
+            int n = cols - c < WORD_BITS ? cols - c : WORD_BITS;
+            golStoreCells(&out[calcIndex(outWords, 0, r)], c, golLoadCells(row, x + c, words), n);
+        }
+    }
+}
+
+int golCheckpointWrite(const char *fileName, const GolCheckpoint *header, const uint64_t *grid, int words, int x, int y) {
+    char temporary[2048];
+    snprintf(temporary, sizeof(temporary), "%s.tmp", fileName);
+    FILE *fp = fopen(temporary, "wb");
+    if (fp == NULL) {
+        fprintf(stderr, "Could not write checkpoint %s\n", temporary);
+        return -1;
+    }
+
+    size_t size = (size_t) calcWords(header->width) * header->height;
+    uint64_t *packed = malloc(size > 0 ? size * sizeof(uint64_t) : 1);
+    golCheckpointPack(grid, words, x, y, header->width, header->height, packed);
+    int failed = fwrite(header, sizeof(GolCheckpoint), 1, fp) != 1 || fwrite(packed, sizeof(uint64_t), size, fp) != size;
+    failed |= fclose(fp) != 0;
+    free(packed);
+
+    if (failed || rename(temporary, fileName) != 0) {
+        fprintf(stderr, "Could not write checkpoint %s\n", fileName);
+        remove(temporary);
+        return -1;
+    }
+    return 0;
+}
+
+int golCheckpointReadHeader(const char *fileName, GolCheckpoint *header) {
+    FILE *fp = fopen(fileName, "rb");
+    if (fp == NULL) return -1;
+    int valid = fread(header, sizeof(GolCheckpoint), 1, fp) == 1 &&
+                memcmp(header->magic, GOL_CHECKPOINT_MAGIC, sizeof(header->magic)) == 0;
+    fclose(fp);
+    return valid ? 0 : -1;
+}
+
+int golCheckpointRead(const char *fileName, uint64_t *grid, int words, int x, int y, int gridX, int gridY, int cols,
+                      int rows) {
+    GolCheckpoint header;
+    FILE *fp = fopen(fileName, "rb");
+    if (fp == NULL || fread(&header, sizeof(GolCheckpoint), 1, fp) != 1) {
+        fprintf(stderr, "Could not read checkpoint %s\n", fileName);
+        if (fp != NULL) fclose(fp);
+        return -1;
+    }
+
+    // overlap of the file's region and the requested one, in grid cells
+    int x0 = (int) header.x0 > gridX ? (int) header.x0 : gridX;
+    int y0 = (int) header.y0 > gridY ? (int) header.y0 : gridY;
+    int x1 = (int) (header.x0 + header.width) < gridX + cols ? (int) (header.x0 + header.width) : gridX + cols;
+    int y1 = (int) (header.y0 + header.height) < gridY + rows ? (int) (header.y0 + header.height) : gridY + rows;
+    if (x0 >= x1 || y0 >= y1) {
+        fclose(fp);
+        return 0;
+    }
+
+    // the overlapping rows are contiguous in the file, they are read in one call
+    int fileWords = calcWords(header.width);
+    size_t size = (size_t) fileWords * (y1 - y0);
+    uint64_t *packed = malloc(size * sizeof(uint64_t));
+    int failed = fseeko(fp, (off_t) golCheckpointRowOffset(header.width, y0 - header.y0), SEEK_SET) != 0 ||
+                 fread(packed, sizeof(uint64_t), size, fp) != size;
+    fclose(fp);
+    if (failed) {
+        fprintf(stderr, "Could not read checkpoint %s\n", fileName);
+        free(packed);
+        return -1;
+    }
+
+    for (int gy = y0; gy < y1; gy++) {
+        const uint64_t *row = &packed[calcIndex(fileWords, 0, gy - y0)];
+        uint64_t *target = &grid[calcIndex(words, 0, y + gy - gridY)];
+        for (int gx = x0; gx < x1; gx += WORD_BITS) {
+            int n = x1 - gx < WORD_BITS ? x1 - gx : WORD_BITS;
+            golStoreCells(target, x + gx - gridX, golLoadCells(row, gx - header.x0, fileWords), n);
+        }
+    }
+    free(packed);
+    return 0;
+}
+
+int golCheckpointFind(const char *prefix, GolCheckpoint *header) {
+    char fileName[2048];
+    GolCheckpoint single, split;
+    golCheckpointFileName(fileName, sizeof(fileName), prefix, 1, 0);
+    int haveSingle = golCheckpointReadHeader(fileName, &single) == 0;
+    golCheckpointFileName(fileName, sizeof(fileName), prefix, 2, 0);
+    int haveSplit = golCheckpointReadHeader(fileName, &split) == 0 && split.pieces > 1;
+
+    if (!haveSingle && !haveSplit) return -1;
+    *header = haveSingle && (!haveSplit || single.generation >= split.generation) ? single : split;
+    return 0;
+}
+
+int golCheckpointLoad(const char *prefix, const GolCheckpoint *header, uint64_t *grid, int words, int x, int y,
+                      int gridX, int gridY, int cols, int rows) {
+    char fileName[2048];
+    for (int piece = 0; piece < (int) header->pieces; piece++) {
+        GolCheckpoint pieceHeader;
+        golCheckpointFileName(fileName, sizeof(fileName), prefix, header->pieces, piece);
+        // a crash between the renames of a split checkpoint leaves pieces of two generations
+        if (golCheckpointReadHeader(fileName, &pieceHeader) != 0 || pieceHeader.generation != header->generation) {
+            fprintf(stderr, "Checkpoint %s is missing or of another generation\n", fileName);
+            return -1;
+        }
+        if (golCheckpointRead(fileName, grid, words, x, y, gridX, gridY, cols, rows) != 0) return -1;
+    }
+    return 0;
+}
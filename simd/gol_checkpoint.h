@@ -0,0 +1,85 @@
+#ifndef GOL_CHECKPOINT_H
+#define GOL_CHECKPOINT_H
+
+#include <stdint.h>
+
+/**
+ * Checkpoint files shared by the OpenMP and the MPI build.
+ *
+ * A file holds the header below and the cells of a rectangular region of the grid, bit-packed like the grids of both
+ * builds: `height` rows of ceil(width / 64) words each, cell x of a row is bit (x % 64) of word (x / 64). A checkpoint
+ * is either one file of the whole grid or `pieces` files of separate regions, e.g. one per MPI rank, so it can be read
+ * back on any decomposition.
+ */
+
+#define GOL_CHECKPOINT_MAGIC "GOLCKPT2"
+
+typedef struct {
+    char magic[8];
+    // the whole grid
+    uint64_t gridWidth, gridHeight;
+    // the region of the grid held by this file
+    uint64_t x0, y0, width, height;
+    // number of files the checkpoint is split into
+    uint64_t pieces;
+    // generation of the cells
+    int64_t generation;
+    // seed of the random initial field
+    uint64_t seed;
+    // rule the cells evolve by, the birth and survive bits of a GolRule
+    uint32_t birth, survive;
+} GolCheckpoint;
+
+/**
+ * Name of file `piece` of a checkpoint split into `pieces` files: "<prefix>.gol" for a single file, otherwise
+ * "<prefix>-<piece>.gol".
+ */
+void golCheckpointFileName(char *out, int size, const char *prefix, uint64_t pieces, int piece);
+
+/**
+ * Byte offset of region row `row` in a checkpoint file whose region is `width` cells wide.
+ */
+uint64_t golCheckpointRowOffset(uint64_t width, uint64_t row);
+
+/**
+ * Packs the cols x rows cells starting at cell (x, y) of a grid with `words` words per row into rows of
+ * ceil(cols / 64) words, the unused bits of the last word are zero.
+ */
+void golCheckpointPack(const uint64_t *grid, int words, int x, int y, int cols, int rows, uint64_t *out);
+
+/**
+ * Writes the region described by `header` from cell (x, y) of a grid with `words` words per row. The file is written
+ * under a temporary name and renamed when complete, a crash never leaves a truncated checkpoint behind.
+ * Returns 0 on success, -1 if the file could not be written.
+ */
+int golCheckpointWrite(const char *fileName, const GolCheckpoint *header, const uint64_t *grid, int words, int x, int y);
+
+/**
+ * Reads and checks the header of a checkpoint file. Returns 0 on success, -1 if the file is missing or not a
+ * checkpoint.
+ */
+int golCheckpointReadHeader(const char *fileName, GolCheckpoint *header);
+
+/**
+ * Copies the part of the file's region that lies in the cols x rows cells starting at grid cell (gridX, gridY) to the
+ * matching cells of a grid with `words` words per row, where grid cell (gridX, gridY) is cell (x, y).
+ * Returns 0 on success, -1 if the file could not be read.
+ */
+int golCheckpointRead(const char *fileName, uint64_t *grid, int words, int x, int y, int gridX, int gridY, int cols,
+                      int rows);
+
+/**
+ * Looks for the checkpoint "<prefix>.gol" or the split one starting with "<prefix>-000.gol" and fills in the header of
+ * the one with the later generation. Returns 0 if one was found, -1 otherwise.
+ */
+int golCheckpointFind(const char *prefix, GolCheckpoint *header);
+
+/**
+ * Reads the cols x rows cells starting at grid cell (gridX, gridY) from every file of the checkpoint found by
+ * golCheckpointFind() into a grid as golCheckpointRead() does. Returns 0 on success, -1 if a file is missing or holds
+ * another generation.
+ */
+int golCheckpointLoad(const char *prefix, const GolCheckpoint *header, uint64_t *grid, int words, int x, int y,
+                      int gridX, int gridY, int cols, int rows);
+
+#endif
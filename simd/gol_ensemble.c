@@ -0,0 +1,105 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <omp.h>
+
+#include "gol_ensemble.h"
+#include "gol_random.h"
+
+#define WORD_BITS 64
+#define calcWords(width)  (((width) + WORD_BITS - 1) / WORD_BITS)
+#define calcIndex(width, x, y)  ((y)*(width) + (x))
+
+/**
+ * Word j (-1 .. words) of a periodic row as its neighbours see it: word -1 carries cell w-1 in its top bit, the partial
+ * last word and word `words` carry cell 0 right after cell w-1.
+ */
+static uint64_t periodicWord(const uint64_t *row, int j, int w) {
+    int words = calcWords(w);
+    if (j < 0) return ((row[(w - 1) / WORD_BITS] >> ((w - 1) % WORD_BITS)) & 1) << (WORD_BITS - 1);
+    if (j >= words) return w % WORD_BITS == 0 ? row[0] & 1 : 0;
+    if (j == words - 1 && w % WORD_BITS != 0) return row[j] | ((row[0] & 1) << (w % WORD_BITS));
+    return row[j];
+}
+
+static uint64_t evolveWordPeriodic(const uint64_t *above, const uint64_t *row, const uint64_t *below, int j, int w,
+                                   GolRule rule) {
+    return golEvolveWord(periodicWord(above, j - 1, w), periodicWord(above, j, w), periodicWord(above, j + 1, w),
+                         periodicWord(row, j - 1, w), periodicWord(row, j, w), periodicWord(row, j + 1, w),
+                         periodicWord(below, j - 1, w), periodicWord(below, j, w), periodicWord(below, j + 1, w),
+                         rule);
+}
+
+/**
+ * Computes the next generation of a periodic w x h grid, returns 1 if a cell changed. The cells past w in the last
+ * word of a row stay dead.
+ */
+static int evolveGrid(const uint64_t *currentfield, uint64_t *newfield, int w, int h, GolRowKernel rowKernel) {
+    int words = calcWords(w);
+    uint64_t last = w % WORD_BITS == 0 ? ~(uint64_t) 0 : ((uint64_t) 1 << (w % WORD_BITS)) - 1;
+    uint64_t changed = 0;
+    for (int y = 0; y < h; y++) {
+        const uint64_t *row = &currentfield[calcIndex(words, 0, y)];
+        const uint64_t *above = y > 0 ? row - words : &currentfield[calcIndex(words, 0, h - 1)];
+        const uint64_t *below = y < h - 1 ? row + words : currentfield;
+        uint64_t *next = &newfield[calcIndex(words, 0, y)];
+        if (words > 2) golEvolveRow(rowKernel, above, row, below, next, 1, words - 1, words);
+        next[0] = evolveWordPeriodic(above, row, below, 0, w, rowKernel.rule);
+        next[words - 1] = evolveWordPeriodic(above, row, below, words - 1, w, rowKernel.rule) & last;
+        for (int j = 0; j < words; j++) changed |= next[j] ^ row[j];
+    }
+    return changed != 0;
+}
+
+double golEnsembleRun(GolInstance *instances, int count, int w, int h, long timeSteps, int check,
+                      GolRowKernel rowKernel, int threads) {
+    int words = calcWords(w);
+    double start = omp_get_wtime();
+
+#pragma omp parallel num_threads(threads)
+    {
+        // two grids per thread, reused by all its instances
+        uint64_t *currentfield = calloc(words * h, sizeof(uint64_t));
+        uint64_t *newfield = calloc(words * h, sizeof(uint64_t));
+        if (currentfield == NULL || newfield == NULL) {
+            fprintf(stderr, "Could not allocate the grids of an ensemble thread\n");
+            exit(1);
+        }
+
+#pragma omp for schedule(dynamic)
+        for (int i = 0; i < count; i++) {
+            GolInstance *instance = &instances[i];
+            golRandomFill(currentfield, words, 0, 0, 0, 0, w, h, instance->seed);
+            instance->steady = 0;
+            long t;
+            for (t = 0; !instance->steady && t < timeSteps; t++) {
+                int changed = evolveGrid(currentfield, newfield, w, h, rowKernel);
+                if (check > 0 && t % check == 0 && !changed) instance->steady = 1;
+
+                uint64_t *temp = currentfield;
+                currentfield = newfield;
+                newfield = temp;
+            }
+            instance->generations = t;
+            instance->population = 0;
+            for (int j = 0; j < words * h; j++) instance->population += __builtin_popcountll(currentfield[j]);
+        }
+        free(currentfield);
+        free(newfield);
+    }
+    return omp_get_wtime() - start;
+}
+
+int golEnsembleWrite(const char *fileName, const GolInstance *instances, int count) {
+    FILE *fp = fopen(fileName, "w");
+    if (fp == NULL) {
+        fprintf(stderr, "Could not write ensemble summary %s\n", fileName);
+        return -1;
+    }
+    fprintf(fp, "instance,seed,generations,population,steady\n");
+    for (int i = 0; i < count; i++) {
+        fprintf(fp, "%d,%llu,%ld,%ld,%d\n", i, (unsigned long long) instances[i].seed, instances[i].generations,
+                instances[i].population, instances[i].steady);
+    }
+    return fclose(fp) == 0 ? 0 : -1;
+}
@@ -0,0 +1,37 @@
+#ifndef GOL_ENSEMBLE_H
+#define GOL_ENSEMBLE_H
+
+#include <stdint.h>
+
+#include "gol_kernel.h"
+
+/**
+ * Ensemble mode shared by the OpenMP and the MPI build: many independent small periodic grids in one process.
+ *
+ * Every instance is a grid of its own, filled randomly from its seed exactly like the single game with that seed, and
+ * runs until the last generation or until it stops changing. The instances are handed out dynamically to the threads,
+ * every thread keeps two grids that fit into its caches and evolves one instance after the other with the row kernels.
+ */
+
+typedef struct {
+    uint64_t seed;
+    long generations;   ///< generations computed, fewer than asked for if the grid became steady
+    long population;    ///< live cells of the last generation
+    int steady;         ///< 1 if the last generation equals the one before
+} GolInstance;
+
+/**
+ * Runs the `count` instances, each a w x h grid filled from its seed, for timeSteps generations under the rule of
+ * rowKernel with `threads` threads. Every `check`-th generation is compared with the one before, an instance ends at
+ * the first one without a change (0 never checks). Returns the seconds it took.
+ */
+double golEnsembleRun(GolInstance *instances, int count, int w, int h, long timeSteps, int check,
+                      GolRowKernel rowKernel, int threads);
+
+/**
+ * Writes one `instance,seed,generations,population,steady` CSV row per instance. Returns 0 on success, -1 if the file
+ * could not be written.
+ */
+int golEnsembleWrite(const char *fileName, const GolInstance *instances, int count);
+
+#endif
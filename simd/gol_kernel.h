@@ -0,0 +1,157 @@
+#ifndef GOL_KERNEL_H
+#define GOL_KERNEL_H
+
+#include <stdint.h>
+
+/**
+ * Bit-parallel evolve kernels shared by the OpenMP and the MPI build.
+ *
+ * Rows are bit-packed (cell x is bit x % 64 of word x / 64). The neighbour counts of 64 cells are computed at once
+ * with bit-sliced full adders, the SIMD variants process 2 (SSE2), 4 (AVX2) or 8 (AVX-512) words per instruction.
+ * The next state follows from the counts by a Life-like B/S rule: Conway's rule and a few common ones have kernels of
+ * their own, every other rule runs on a generic kernel that evaluates the full count.
+ */
+
+typedef enum {
+    GOL_KERNEL_SCALAR,
+    GOL_KERNEL_SSE2,
+    GOL_KERNEL_AVX2,
+    GOL_KERNEL_AVX512,
+    GOL_KERNEL_COUNT
+} GolKernel;
+
+/**
+ * How a kernel counts neighbours: the stencil mode loads the 3x3 neighbourhood words of every output word, the rowsum
+ * mode slides 2-bit column sums along the row and loads every input word once.
+ */
+typedef enum {
+    GOL_MODE_STENCIL,
+    GOL_MODE_ROWSUM,
+    GOL_MODE_COUNT
+} GolMode;
+
+/**
+ * Life-like rule: bit n of birth is set if a dead cell with n neighbours is born, bit n of survive if a live cell with
+ * n neighbours stays alive.
+ */
+typedef struct {
+    uint16_t birth, survive;
+} GolRule;
+
+#define GOL_RULE_CONWAY ((GolRule) {1 << 3, 1 << 2 | 1 << 3})
+
+/**
+ * Parses a rule in B/S notation ("B36/S23", case and the slash are optional) or in the older S/B notation ("23/36").
+ * Returns 0, or -1 if the text is no rule or a B0 rule: the kernels count the cells outside the grid as dead, which
+ * would not stay dead under B0.
+ */
+int golParseRule(const char *text, GolRule *rule);
+
+/**
+ * Writes the rule in B/S notation, e.g. "B3/S23", 22 characters hold every rule.
+ */
+void golFormatRule(GolRule rule, char *out, int size);
+
+/**
+ * Name of the kernel the rule runs on ("conway", "highlife", "daynight", "seeds" or "generic").
+ */
+const char *golRuleKernelName(GolRule rule);
+
+/**
+ * Computes out[from .. to) of the next generation of a packed row with `words` words under the rule.
+ * above/below are the neighbouring rows, cells left of word 0 and right of word words-1 count as dead. The kernels of
+ * the rules with a kernel of their own have the rule built in and ignore the argument.
+ */
+typedef void (*GolRowFunction)(const uint64_t *above, const uint64_t *row, const uint64_t *below, uint64_t *out,
+                               int from, int to, int words, GolRule rule);
+
+/**
+ * A row kernel together with the rule it was picked for, it always computes that rule.
+ */
+typedef struct {
+    GolRowFunction function;
+    GolRule rule;
+} GolRowKernel;
+
+/**
+ * Computes out[from .. to) of the next generation of a packed row with `words` words under the kernel's rule.
+ */
+static inline void golEvolveRow(GolRowKernel kernel, const uint64_t *above, const uint64_t *row, const uint64_t *below,
+                                uint64_t *out, int from, int to, int words) {
+    kernel.function(above, row, below, out, from, to, words, kernel.rule);
+}
+
+/**
+ * Next state of a single word r under the rule, given the words left (p) and right (n) of it in the row above (a), the
+ * row itself (r) and the row below (b). Used for border words whose neighbour words the caller assembles itself.
+ */
+uint64_t golEvolveWord(uint64_t ap, uint64_t a, uint64_t an,
+                       uint64_t rp, uint64_t r, uint64_t rn,
+                       uint64_t bp, uint64_t b, uint64_t bn, GolRule rule);
+
+const char *golKernelName(GolKernel kernel);
+
+int golKernelSupported(GolKernel kernel);
+
+const char *golModeName(GolMode mode);
+
+/**
+ * Picks the evolve mode by name ("stencil", "rowsum"), NULL selects the stencil mode.
+ */
+GolMode golSelectMode(const char *name);
+
+/**
+ * The row kernel of the rule. Rules without a kernel of their own share the generic one, which evaluates the rule the
+ * returned kernel carries.
+ */
+GolRowKernel golRowKernel(GolKernel kernel, GolMode mode, GolRule rule);
+
+/**
+ * Runs the kernel on random rows and compares every cell against a per-cell reference count under the rule.
+ * Returns 1 if the output is identical.
+ */
+int golCheckKernel(GolKernel kernel, GolMode mode, GolRule rule);
+
+/**
+ * Picks the kernel by name ("scalar", "sse2", "avx2", "avx512"), NULL or "auto" selects the widest one the CPU
+ * supports. The choice is verified with golCheckKernel() and falls back to the scalar kernel on a mismatch.
+ */
+GolKernel golSelectKernel(const char *name, GolMode mode, GolRule rule);
+
+/**
+ * The 64 cells starting at cell x (may be negative) of a packed row with `words` words, cells outside count as dead.
+ */
+uint64_t golLoadCells(const uint64_t *row, int x, int words);
+
+/**
+ * Copies n words of cells, starting at cell x, of a packed row into out; the same as n calls of golLoadCells().
+ */
+void golLoadRow(uint64_t *out, const uint64_t *row, int x, int n, int words);
+
+/**
+ * Overwrites the n (1 .. 64) cells starting at cell x of a packed row with the lowest n bits of cells.
+ */
+void golStoreCells(uint64_t *row, int x, uint64_t cells, int n);
+
+/**
+ * Returns 1 if the cells x0 .. x1-1 of the packed rows a and b differ. Called right after a row has been computed, while
+ * both rows are still in cache, to track changes without an extra pass over the grid.
+ */
+int golCellsDiffer(const uint64_t *a, const uint64_t *b, int x0, int x1);
+
+/**
+ * Temporal blocking: picks the size of a block that, together with its halo of `generations` cells and a second
+ * buffer, fits into half of the L2 cache. The block is at most width x height cells.
+ */
+void golBlockSize(int width, int height, int generations, int *blockWidth, int *blockHeight);
+
+/**
+ * Advances a block of `rows` packed rows by `generations` generations, alternating between block and scratch.
+ * Cells outside the block count as dead, so afterwards only the cells at least `generations` cells away from the block
+ * border are exact; each generation skips the rows that no longer reach that region (trapezoid).
+ * Returns the buffer holding the last generation.
+ */
+uint64_t *golAdvanceBlock(uint64_t *block, uint64_t *scratch, int words, int rows, int generations,
+                          GolRowKernel rowKernel);
+
+#endif
@@ -0,0 +1,102 @@
+#include <stdint.h>
+
+#include <immintrin.h>//AVX2, AVX-512
+
+#include "gol_kernel.h"
+#include "gol_random.h"
+
+#define WORD_BITS 64
+#define calcIndex(width, x, y)  ((y)*(width) + (x))
+
+// SplitMix64: the state advances by the golden ratio, the output is the finalised state
+#define GOLDEN 0x9E3779B97F4A7C15ULL
+#define MIX1 0xBF58476D1CE4E5B9ULL
+#define MIX2 0x94D049BB133111EBULL
+// a cell is alive if the upper 32 bits of its output are below 2^32 / 10
+#define THRESHOLD 0x1999999AULL
+
+typedef uint64_t (*CellsFunction)(uint64_t state);
+
+/**
+ * The 64 cells whose counters follow the one of state = seed + (counter + 1) * GOLDEN.
+ */
+static uint64_t cellsScalar(uint64_t state) {
+    uint64_t cells = 0;
+    for (int i = 0; i < WORD_BITS; i++) {
+        uint64_t z = state + i * GOLDEN;
+        z = (z ^ (z >> 30)) * MIX1;
+        z = (z ^ (z >> 27)) * MIX2;
+        z ^= z >> 31;
+        cells |= (uint64_t) ((z >> 32) < THRESHOLD) << i;
+    }
+    return cells;
+}
+
+/**
+ * Low 64 bits of the lane-wise product, AVX2 only multiplies 32-bit halves.
+ */
+__attribute__((target("avx2")))
+static inline __m256i mul64AVX2(__m256i a, __m256i b) {
+    __m256i low = _mm256_mul_epu32(a, b);
+    __m256i cross = _mm256_add_epi64(_mm256_mul_epu32(_mm256_srli_epi64(a, 32), b),
+                                     _mm256_mul_epu32(a, _mm256_srli_epi64(b, 32)));
+    return _mm256_add_epi64(low, _mm256_slli_epi64(cross, 32));
+}
+
+__attribute__((target("avx2")))
+static uint64_t cellsAVX2(uint64_t state) {
+    const __m256i mix1 = _mm256_set1_epi64x((long long) MIX1);
+    const __m256i mix2 = _mm256_set1_epi64x((long long) MIX2);
+    const __m256i step = _mm256_set1_epi64x((long long) (4 * GOLDEN));
+    // the upper halves are below 2^32, the signed comparison is exact
+    const __m256i threshold = _mm256_set1_epi64x((long long) THRESHOLD);
+    __m256i z0 = _mm256_setr_epi64x((long long) state, (long long) (state + GOLDEN), (long long) (state + 2 * GOLDEN),
+                                    (long long) (state + 3 * GOLDEN));
+    uint64_t cells = 0;
+    for (int i = 0; i < WORD_BITS; i += 4) {
+        __m256i z = z0;
+        z = mul64AVX2(_mm256_xor_si256(z, _mm256_srli_epi64(z, 30)), mix1);
+        z = mul64AVX2(_mm256_xor_si256(z, _mm256_srli_epi64(z, 27)), mix2);
+        z = _mm256_xor_si256(z, _mm256_srli_epi64(z, 31));
+        __m256i alive = _mm256_cmpgt_epi64(threshold, _mm256_srli_epi64(z, 32));
+        cells |= (uint64_t) _mm256_movemask_pd(_mm256_castsi256_pd(alive)) << i;
+        z0 = _mm256_add_epi64(z0, step);
+    }
+    return cells;
+}
+
+__attribute__((target("avx512f")))
+static uint64_t cellsAVX512(uint64_t state) {
+    const __m512i mix1 = _mm512_set1_epi64((long long) MIX1);
+    const __m512i mix2 = _mm512_set1_epi64((long long) MIX2);
+    const __m512i step = _mm512_set1_epi64((long long) (8 * GOLDEN));
+    const __m512i threshold = _mm512_set1_epi64((long long) THRESHOLD);
+    __m512i z0 = _mm512_add_epi64(_mm512_set1_epi64((long long) state),
+                                  _mm512_mullox_epi64(_mm512_setr_epi64(0, 1, 2, 3, 4, 5, 6, 7),
+                                                      _mm512_set1_epi64((long long) GOLDEN)));
+    uint64_t cells = 0;
+    for (int i = 0; i < WORD_BITS; i += 8) {
+        __m512i z = z0;
+        z = _mm512_mullox_epi64(_mm512_xor_si512(z, _mm512_srli_epi64(z, 30)), mix1);
+        z = _mm512_mullox_epi64(_mm512_xor_si512(z, _mm512_srli_epi64(z, 27)), mix2);
+        z = _mm512_xor_si512(z, _mm512_srli_epi64(z, 31));
+        cells |= (uint64_t) _mm512_cmplt_epu64_mask(_mm512_srli_epi64(z, 32), threshold) << i;
+        z0 = _mm512_add_epi64(z0, step);
+    }
+    return cells;
+}
+
+void golRandomFill(uint64_t *grid, int words, int x, int y, int gridX, int gridY, int cols, int rows, uint64_t seed) {
+    CellsFunction cells = cellsScalar;
+    if (golKernelSupported(GOL_KERNEL_AVX512)) cells = cellsAVX512;
+    else if (golKernelSupported(GOL_KERNEL_AVX2)) cells = cellsAVX2;
+
+    for (int r = 0; r < rows; r++) {
+        uint64_t *row = &grid[calcIndex(words, 0, y + r)];
+        uint64_t counter = ((uint64_t) (gridY + r) << 32) + (uint64_t) gridX;
+        for (int c = 0; c < cols; c += WORD_BITS) {
+            int n = cols - c < WORD_BITS ? cols - c : WORD_BITS;
+            golStoreCells(row, x + c, cells(seed + (counter + c + 1) * GOLDEN), n);
+        }
+    }
+}
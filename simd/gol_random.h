@@ -0,0 +1,21 @@
+#ifndef GOL_RANDOM_H
+#define GOL_RANDOM_H
+
+#include <stdint.h>
+
+/**
+ * Counter-based random initial field shared by the OpenMP and the MPI build.
+ *
+ * Whether a cell starts alive depends only on the seed and its global grid coordinates: the cell (x, y) takes the
+ * SplitMix64 output for the counter y * 2^32 + x and is alive with a probability of 1/10. There is no generator state,
+ * threads and ranks fill their own cells in any order and the grid is the same for every decomposition and in both
+ * builds. The cells of a word are computed 8 (AVX-512) or 4 (AVX2) at a time if the CPU supports it.
+ */
+
+/**
+ * Fills the cols x rows cells starting at grid cell (gridX, gridY) into the cells starting at (x, y) of a grid with
+ * `words` words per row, overwriting them.
+ */
+void golRandomFill(uint64_t *grid, int words, int x, int y, int gridX, int gridY, int cols, int rows, uint64_t seed);
+
+#endif
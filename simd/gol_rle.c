@@ -0,0 +1,218 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "gol_rle.h"
+
+#define WORD_BITS 64
+#define calcIndex(width, x, y)  ((y)*(width) + (x))
+
+// a chunk spans at least this many bytes of cell data, small files are decoded in one piece
+#define CHUNK_BYTES (64 * 1024)
+
+struct GolRle {
+    const char *data;
+    size_t size;
+    long width, height;
+    char rule[32];
+    int chunks;
+    // chunk c is data[offset[c] .. offset[c + 1]), it starts in pattern row row[c] at column 0
+    size_t *offset;
+    long *row;
+    // scan results: rows advanced by chunk c and whether the pattern ends in it at 2c and 2c + 1
+    long *counts;
+    // chunks after the one holding the '!' are not part of the pattern
+    int used;
+};
+
+static int isBlank(char c) {
+    return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
+
+static size_t skipLine(const GolRle *rle, size_t p, size_t end) {
+    const char *newline = memchr(rle->data + p, '\n', end - p);
+    return newline != NULL ? (size_t) (newline - rle->data) : end;
+}
+
+/**
+ * Sets the cells a .. b-1 of a packed row.
+ */
+static void setRun(uint64_t *row, long a, long b) {
+    long first = a / WORD_BITS;
+    long last = (b - 1) / WORD_BITS;
+    uint64_t head = ~(uint64_t) 0 << (a % WORD_BITS);
+    uint64_t tail = ~(uint64_t) 0 >> (WORD_BITS - 1 - (b - 1) % WORD_BITS);
+    if (first == last) {
+        row[first] |= head & tail;
+        return;
+    }
+    row[first] |= head;
+    for (long word = first + 1; word < last; word++) row[word] = ~(uint64_t) 0;
+    row[last] |= tail;
+}
+
+GolRle *golRleOpen(const char *fileName, int chunks) {
+    int fd = open(fileName, O_RDONLY);
+    if (fd < 0) return NULL;
+    struct stat status;
+    if (fstat(fd, &status) != 0 || status.st_size == 0) {
+        close(fd);
+        return NULL;
+    }
+    void *data = mmap(NULL, status.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) return NULL;
+#ifdef MADV_SEQUENTIAL
+    madvise(data, status.st_size, MADV_SEQUENTIAL);
+#endif
+
+    GolRle *rle = calloc(1, sizeof(GolRle));
+    rle->data = data;
+    rle->size = status.st_size;
+
+    // comment lines (#) and the "x = .., y = .., rule = .." line come before the cell data
+    size_t start = 0;
+    while (start < rle->size) {
+        size_t p = start;
+        while (p < rle->size && isBlank(rle->data[p])) p++;
+        if (p < rle->size && rle->data[p] == '#') {
+            start = skipLine(rle, p, rle->size) + 1;
+        } else if (p < rle->size && rle->data[p] == 'x') {
+            char line[256];
+            size_t end = skipLine(rle, p, rle->size);
+            size_t length = end - p < sizeof(line) - 1 ? end - p : sizeof(line) - 1;
+            memcpy(line, rle->data + p, length);
+            line[length] = '\0';
+            if (sscanf(line, "x = %ld , y = %ld", &rle->width, &rle->height) != 2) rle->width = rle->height = 0;
+            const char *rule = strstr(line, "rule");
+            if (rule != NULL && sscanf(rule, "rule = %31[^, \t\r]", rle->rule) != 1) rle->rule[0] = '\0';
+            start = end + 1;
+            break;
+        } else {
+            start = p;
+            break;
+        }
+    }
+    if (start > rle->size) start = rle->size;
+
+    // chunk boundaries: the first row start after an even share of the data, chunks may end up empty
+    size_t bytes = rle->size - start;
+    if (chunks > (int) (bytes / CHUNK_BYTES) + 1) chunks = bytes / CHUNK_BYTES + 1;
+    if (chunks < 1) chunks = 1;
+    rle->chunks = chunks;
+    rle->used = chunks;
+    rle->offset = malloc((chunks + 1) * sizeof(size_t));
+    rle->row = calloc(chunks + 1, sizeof(long));
+    rle->counts = calloc(2 * chunks, sizeof(long));
+    rle->offset[0] = start;
+    rle->offset[chunks] = rle->size;
+    for (int c = 1; c < chunks; c++) {
+        size_t p = start + bytes / chunks * c;
+        if (p < rle->offset[c - 1]) p = rle->offset[c - 1];
+        const char *rowEnd = memchr(rle->data + p, '$', rle->size - p);
+        rle->offset[c] = rowEnd != NULL ? (size_t) (rowEnd - rle->data) + 1 : rle->size;
+    }
+    return rle;
+}
+
+int golRleChunks(const GolRle *rle) {
+    return rle->chunks;
+}
+
+void golRleSize(const GolRle *rle, long *width, long *height) {
+    *width = rle->width;
+    *height = rle->height;
+}
+
+const char *golRleRule(const GolRle *rle) {
+    return rle->rule;
+}
+
+void golRleScan(GolRle *rle, int chunk) {
+    long *counts = &rle->counts[2 * chunk];
+    long count = 0;
+    counts[0] = 0;
+    counts[1] = 0;
+    for (size_t p = rle->offset[chunk]; p < rle->offset[chunk + 1]; p++) {
+        char c = rle->data[p];
+        if (c >= '0' && c <= '9') {
+            count = count * 10 + (c - '0');
+        } else if (c == '$') {
+            counts[0] += count > 0 ? count : 1;
+            count = 0;
+        } else if (c == '!') {
+            counts[1] = 1;
+            return;
+        } else if (c == '#') {
+            p = skipLine(rle, p, rle->offset[chunk + 1]);
+        } else if (!isBlank(c)) {
+            count = 0;
+        }
+    }
+}
+
+long *golRleCounts(GolRle *rle) {
+    return rle->counts;
+}
+
+void golRleIndex(GolRle *rle) {
+    const long *counts = rle->counts;
+    rle->used = rle->chunks;
+    for (int c = 0; c < rle->chunks; c++) {
+        rle->row[c + 1] = rle->row[c] + counts[2 * c];
+        if (counts[2 * c + 1] && rle->used == rle->chunks) rle->used = c + 1;
+    }
+}
+
+int golRleDecode(const GolRle *rle, int chunk, uint64_t *grid, int words, int x, int y, int gridX, int gridY, int cols,
+                 int rows) {
+    // the chunk writes the rows row[chunk] .. row[chunk + 1], the last one only up to its final '$'
+    if (chunk >= rle->used || rle->row[chunk + 1] < gridY || rle->row[chunk] >= gridY + rows) return 0;
+
+    long count = 0;
+    long px = 0;
+    long py = rle->row[chunk];
+    for (size_t p = rle->offset[chunk]; p < rle->offset[chunk + 1]; p++) {
+        char c = rle->data[p];
+        long run = count > 0 ? count : 1;
+        if (c >= '0' && c <= '9') {
+            count = count * 10 + (c - '0');
+            continue;
+        } else if (c == 'b') {
+            px += run;
+        } else if (c == 'o') {
+            long a = px > gridX ? px : gridX;
+            long b = px + run < gridX + cols ? px + run : gridX + cols;
+            if (a < b && py >= gridY) setRun(&grid[calcIndex(words, 0, y + py - gridY)], x + a - gridX, x + b - gridX);
+            px += run;
+        } else if (c == '$') {
+            py += run;
+            px = 0;
+            if (py >= gridY + rows) break;
+        } else if (c == '!') {
+            break;
+        } else if (c == '#') {
+            p = skipLine(rle, p, rle->offset[chunk + 1]);
+        } else if (!isBlank(c)) {
+            fprintf(stderr, "Invalid character read: %d\n", c);
+            return -1;
+        } else {
+            continue;
+        }
+        count = 0;
+    }
+    return 0;
+}
+
+void golRleClose(GolRle *rle) {
+    munmap((void *) rle->data, rle->size);
+    free(rle->offset);
+    free(rle->row);
+    free(rle->counts);
+    free(rle);
+}
@@ -0,0 +1,69 @@
+#ifndef GOL_RLE_H
+#define GOL_RLE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * RLE pattern loader shared by the OpenMP and the MPI build.
+ *
+ * The file is memory-mapped and its cell data cut into chunks that start right after a '$', i.e. at the beginning of a
+ * pattern row. Loading takes three passes: every chunk is scanned for the rows it advances (golRleScan), the starting
+ * row of every chunk follows from a prefix sum (golRleIndex), then the chunks are decoded independently
+ * (golRleDecode). Chunks cover separate rows, so the scans and the decodes can run on different threads or ranks, and
+ * a decode only writes the cells of a given region of the grid.
+ * The pattern is placed with its top left cell at grid cell (0, 0), cells beyond the grid are dropped.
+ */
+
+typedef struct GolRle GolRle;
+
+/**
+ * Maps the file and cuts its cell data into at most `chunks` chunks. Returns NULL if the file cannot be mapped.
+ */
+GolRle *golRleOpen(const char *fileName, int chunks);
+
+/**
+ * Number of chunks the cell data was cut into.
+ */
+int golRleChunks(const GolRle *rle);
+
+/**
+ * Pattern size from the "x = .., y = .." header line, 0 if the file has none.
+ */
+void golRleSize(const GolRle *rle, long *width, long *height);
+
+/**
+ * Rule from the "rule = .." field of the header line, e.g. "B3/S23", an empty string if the file has none.
+ */
+const char *golRleRule(const GolRle *rle);
+
+/**
+ * Scans chunk `chunk` for the rows it advances and whether the pattern ends ('!') in it.
+ */
+void golRleScan(GolRle *rle, int chunk);
+
+/**
+ * The scan results, two longs per chunk (rows advanced, pattern ends), e.g. to combine scans done on different ranks.
+ * Chunks that were not scanned hold zeros.
+ */
+long *golRleCounts(GolRle *rle);
+
+/**
+ * Computes the row every chunk starts in from the scan results of all chunks.
+ */
+void golRleIndex(GolRle *rle);
+
+/**
+ * Decodes chunk `chunk` into the cols x rows cells starting at grid cell (gridX, gridY) of a zeroed grid with `words`
+ * words per row, where grid cell (gridX, gridY) is cell (x, y). Chunks outside the region are skipped without reading
+ * them. Returns 0, or -1 on a character that is not part of a two-state pattern.
+ */
+int golRleDecode(const GolRle *rle, int chunk, uint64_t *grid, int words, int x, int y, int gridX, int gridY, int cols,
+                 int rows);
+
+/**
+ * Unmaps the file.
+ */
+void golRleClose(GolRle *rle);
+
+#endif
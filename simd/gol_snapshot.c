@@ -0,0 +1,112 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+
+#include <pthread.h>
+
+#include "gol_snapshot.h"
+
+struct GolSnapshots {
+    int buffers;
+    size_t bytes;
+    uint64_t **field;
+    long *timestep;
+    // the queued buffers are head .. head + queued - 1 (mod buffers), the I/O thread writes buffer head
+    int head;
+    int queued;
+    int stopping;
+    double stall;
+    GolSnapshotWriter writer;
+    void *context;
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_cond_t filled;
+    pthread_cond_t freed;
+};
+
+static double now(void) {
+    struct timespec time;
+    clock_gettime(CLOCK_MONOTONIC, &time);
+    return time.tv_sec + time.tv_nsec * 1e-9;
+}
+
+static void *ioThread(void *argument) {
+    GolSnapshots *snapshots = argument;
+
+    pthread_mutex_lock(&snapshots->lock);
+    for (;;) {
+        while (snapshots->queued == 0 && !snapshots->stopping) pthread_cond_wait(&snapshots->filled, &snapshots->lock);
+        if (snapshots->queued == 0) break;
+        int slot = snapshots->head;
+        // the buffer stays queued while it is written, so golSnapshot() cannot hand it out again
+        pthread_mutex_unlock(&snapshots->lock);
+        snapshots->writer(snapshots->timestep[slot], snapshots->field[slot], snapshots->context);
+        pthread_mutex_lock(&snapshots->lock);
+        snapshots->head = (slot + 1) % snapshots->buffers;
+        snapshots->queued--;
+        pthread_cond_signal(&snapshots->freed);
+    }
+    pthread_mutex_unlock(&snapshots->lock);
+    return NULL;
+}
+
+GolSnapshots *golSnapshotsCreate(int buffers, size_t bytes, GolSnapshotWriter writer, void *context) {
+    GolSnapshots *snapshots = calloc(1, sizeof(GolSnapshots));
+    snapshots->buffers = buffers > 0 ? buffers : 1;
+    snapshots->bytes = bytes;
+    snapshots->field = malloc(snapshots->buffers * sizeof(uint64_t *));
+    snapshots->timestep = malloc(snapshots->buffers * sizeof(long));
+    for (int i = 0; i < snapshots->buffers; i++) snapshots->field[i] = malloc(bytes > 0 ? bytes : 1);
+    snapshots->writer = writer;
+    snapshots->context = context;
+    pthread_mutex_init(&snapshots->lock, NULL);
+    pthread_cond_init(&snapshots->filled, NULL);
+    pthread_cond_init(&snapshots->freed, NULL);
+    if (pthread_create(&snapshots->thread, NULL, ioThread, snapshots) != 0) {
+        fprintf(stderr, "Could not start the I/O thread\n");
+        exit(1);
+    }
+    return snapshots;
+}
+
+void golSnapshot(GolSnapshots *snapshots, long timestep, const uint64_t *field) {
+    pthread_mutex_lock(&snapshots->lock);
+    if (snapshots->queued == snapshots->buffers) {
+        double start = now();
+        while (snapshots->queued == snapshots->buffers) pthread_cond_wait(&snapshots->freed, &snapshots->lock);
+        snapshots->stall += now() - start;
+    }
+    int slot = (snapshots->head + snapshots->queued) % snapshots->buffers;
+    pthread_mutex_unlock(&snapshots->lock);
+
+    // the slot is not queued yet, the I/O thread does not read it during the copy
+    memcpy(snapshots->field[slot], field, snapshots->bytes);
+    snapshots->timestep[slot] = timestep;
+
+    pthread_mutex_lock(&snapshots->lock);
+    snapshots->queued++;
+    pthread_cond_signal(&snapshots->filled);
+    pthread_mutex_unlock(&snapshots->lock);
+}
+
+double golSnapshotStall(const GolSnapshots *snapshots) {
+    return snapshots->stall;
+}
+
+void golSnapshotsFree(GolSnapshots *snapshots) {
+    pthread_mutex_lock(&snapshots->lock);
+    snapshots->stopping = 1;
+    pthread_cond_signal(&snapshots->filled);
+    pthread_mutex_unlock(&snapshots->lock);
+    pthread_join(snapshots->thread, NULL);
+
+    for (int i = 0; i < snapshots->buffers; i++) free(snapshots->field[i]);
+    free(snapshots->field);
+    free(snapshots->timestep);
+    pthread_mutex_destroy(&snapshots->lock);
+    pthread_cond_destroy(&snapshots->filled);
+    pthread_cond_destroy(&snapshots->freed);
+    free(snapshots);
+}
@@ -0,0 +1,42 @@
+#ifndef GOL_SNAPSHOT_H
+#define GOL_SNAPSHOT_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * Background output shared by the OpenMP and the MPI build.
+ *
+ * A snapshot copies the packed grid of a generation into a ring of buffers and returns, a dedicated I/O thread writes
+ * the queued generations in order while the simulation goes on. Only when every buffer is still waiting to be written
+ * does a snapshot block until the I/O thread frees one.
+ */
+
+typedef struct GolSnapshots GolSnapshots;
+
+/**
+ * Writes one queued generation, called on the I/O thread with the `context` given to golSnapshotsCreate.
+ */
+typedef void (*GolSnapshotWriter)(long timestep, const uint64_t *field, void *context);
+
+/**
+ * Starts the I/O thread with a ring of `buffers` grid buffers of `bytes` bytes each.
+ */
+GolSnapshots *golSnapshotsCreate(int buffers, size_t bytes, GolSnapshotWriter writer, void *context);
+
+/**
+ * Copies the grid of generation `timestep` into a free buffer and queues it for the I/O thread.
+ */
+void golSnapshot(GolSnapshots *snapshots, long timestep, const uint64_t *field);
+
+/**
+ * Seconds golSnapshot() waited for a free buffer so far.
+ */
+double golSnapshotStall(const GolSnapshots *snapshots);
+
+/**
+ * Waits until every queued generation is written, stops the I/O thread and frees the buffers.
+ */
+void golSnapshotsFree(GolSnapshots *snapshots);
+
+#endif
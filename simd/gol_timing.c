@@ -0,0 +1,68 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "gol_timing.h"
+
+static const char *phaseNames[GOL_PHASE_COUNT] = {"evolve", "barrier", "halo", "allreduce", "swap", "output",
+                                                  "checkpoint"};
+
+double golCellsPerSecond(const GolRun *run) {
+    return run->seconds > 0 ? (double) run->width * run->height * run->generations / run->seconds : 0;
+}
+
+double golImbalance(const GolRun *run, const GolTimes *times) {
+    int workers = run->ranks * run->threads;
+    double sum = 0, max = 0;
+    for (int i = 0; i < workers; i++) {
+        double evolve = times[i].seconds[GOL_PHASE_EVOLVE];
+        sum += evolve;
+        if (evolve > max) max = evolve;
+    }
+    return sum > 0 ? max * workers / sum : 1;
+}
+
+int golTimingWrite(const char *fileName, const GolRun *run, const GolTimes *times) {
+    FILE *fp = fopen(fileName, "w");
+    if (fp == NULL) {
+        fprintf(stderr, "Could not write timing report %s\n", fileName);
+        return -1;
+    }
+    size_t length = strlen(fileName);
+    int json = length >= 5 && strcmp(fileName + length - 5, ".json") == 0;
+    int workers = run->ranks * run->threads;
+
+    if (json) {
+        fprintf(fp, "{\n");
+        fprintf(fp, "  \"build\": \"%s\",\n", run->build);
+        fprintf(fp, "  \"width\": %ld,\n  \"height\": %ld,\n  \"generations\": %ld,\n", run->width, run->height,
+                run->generations);
+        fprintf(fp, "  \"ranks\": %d,\n  \"threads\": %d,\n", run->ranks, run->threads);
+        fprintf(fp, "  \"seconds\": %.9g,\n", run->seconds);
+        fprintf(fp, "  \"cells_per_second\": %.9g,\n", golCellsPerSecond(run));
+        fprintf(fp, "  \"imbalance\": %.9g,\n", golImbalance(run, times));
+        fprintf(fp, "  \"workers\": [\n");
+        for (int i = 0; i < workers; i++) {
+            fprintf(fp, "    {\"rank\": %d, \"thread\": %d", i / run->threads, i % run->threads);
+            for (int phase = 0; phase < GOL_PHASE_COUNT; phase++) {
+                fprintf(fp, ", \"%s\": %.9g", phaseNames[phase], times[i].seconds[phase]);
+            }
+            fprintf(fp, "}%s\n", i + 1 < workers ? "," : "");
+        }
+        fprintf(fp, "  ]\n}\n");
+    } else {
+        fprintf(fp, "rank,thread,metric,value\n");
+        fprintf(fp, "-1,-1,width,%ld\n-1,-1,height,%ld\n-1,-1,generations,%ld\n", run->width, run->height,
+                run->generations);
+        fprintf(fp, "-1,-1,ranks,%d\n-1,-1,threads,%d\n", run->ranks, run->threads);
+        fprintf(fp, "-1,-1,seconds,%.9g\n", run->seconds);
+        fprintf(fp, "-1,-1,cells_per_second,%.9g\n", golCellsPerSecond(run));
+        fprintf(fp, "-1,-1,imbalance,%.9g\n", golImbalance(run, times));
+        for (int i = 0; i < workers; i++) {
+            for (int phase = 0; phase < GOL_PHASE_COUNT; phase++) {
+                fprintf(fp, "%d,%d,%s,%.9g\n", i / run->threads, i % run->threads, phaseNames[phase],
+                        times[i].seconds[phase]);
+            }
+        }
+    }
+    return fclose(fp) == 0 ? 0 : -1;
+}
@@ -0,0 +1,54 @@
+#ifndef GOL_TIMING_H
+#define GOL_TIMING_H
+
+/**
+ * Per-phase timing shared by the OpenMP and the MPI build.
+ *
+ * Every worker (a thread of a rank) accumulates the seconds it spends in each phase of the time loop, the report adds
+ * the throughput in cell updates per second and the load imbalance, the slowest worker's evolve time over the mean
+ * one. It is written as CSV, one `rank,thread,metric,value` row per value with -1 for values of the whole run, or as
+ * JSON if the file name ends in ".json".
+ */
+
+typedef enum {
+    GOL_PHASE_EVOLVE,       ///< computing generations
+    GOL_PHASE_BARRIER,      ///< waiting for the other threads at the end of a step
+    GOL_PHASE_HALO,         ///< waiting for the halo exchange (MPI_Waitall)
+    GOL_PHASE_ALLREDUCE,    ///< waiting for the steady-state reduction
+    GOL_PHASE_SWAP,         ///< swapping the grids and activity maps
+    GOL_PHASE_OUTPUT,       ///< handing generations to the vtk output
+    GOL_PHASE_CHECKPOINT,   ///< writing checkpoints
+    GOL_PHASE_COUNT
+} GolPhase;
+
+// one cache line per worker, threads update their own entry without false sharing
+typedef struct {
+    double seconds[8];
+} GolTimes;
+
+typedef struct {
+    const char *build;
+    long width, height;
+    long generations;
+    int ranks, threads;
+    // wall time of the time loop, the slowest rank's for MPI
+    double seconds;
+} GolRun;
+
+/**
+ * Cell updates per second of the run.
+ */
+double golCellsPerSecond(const GolRun *run);
+
+/**
+ * Slowest evolve time over the mean one of the run->ranks * run->threads workers, rank-major.
+ */
+double golImbalance(const GolRun *run, const GolTimes *times);
+
+/**
+ * Writes the report of the run->ranks * run->threads workers, rank-major. Returns 0 on success, -1 if the file could
+ * not be written.
+ */
+int golTimingWrite(const char *fileName, const GolRun *run, const GolTimes *times);
+
+#endif
@@ -0,0 +1,108 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#include <zlib.h>
+
+#include "gol_kernel.h"
+#include "gol_vtk.h"
+
+#define WORD_BITS 64
+#define calcIndex(width, x, y)  ((y)*(width) + (x))
+
+// uncompressed bytes per zlib block of the appended data
+#define ZLIB_BLOCK (64 * 1024)
+
+static const char *formatNames[GOL_VTK_FORMAT_COUNT] = {"float32", "uint8", "bit"};
+static const char *typeNames[GOL_VTK_FORMAT_COUNT] = {"Float32", "UInt8", "Bit"};
+
+GolVtkFormat golSelectVtkFormat(const char *name) {
+    for (int f = 0; name != NULL && f < GOL_VTK_FORMAT_COUNT; f++) {
+        if (strcmp(name, formatNames[f]) == 0) return f;
+    }
+    if (name != NULL) fprintf(stderr, "Unknown vtk format %s, using %s\n", name, formatNames[GOL_VTK_FLOAT32]);
+    return GOL_VTK_FLOAT32;
+}
+
+const char *golVtkTypeName(GolVtkFormat format) {
+    return typeNames[format];
+}
+
+const char *golVtkCompressor(int compress) {
+    return compress ? " compressor=\"vtkZLibDataCompressor\"" : "";
+}
+
+uint64_t golVtkPayloadSize(uint64_t cells, GolVtkFormat format) {
+    switch (format) {
+        case GOL_VTK_UINT8: return cells;
+        case GOL_VTK_BIT: return (cells + 7) / 8;
+        default: return cells * sizeof(float);
+    }
+}
+
+uint64_t golVtkEncode(const uint64_t *grid, int words, int x0, int y0, int cols, int rows, GolVtkFormat format,
+                      unsigned char *out) {
+    uint64_t size = golVtkPayloadSize((uint64_t) cols * rows, format);
+    float *values = (float *) out;
+    uint64_t k = 0;
+    if (format == GOL_VTK_BIT) memset(out, 0, size);
+
+    for (int y = y0; y < y0 + rows; y++) {
+        const uint64_t *row = &grid[calcIndex(words, 0, y)];
+        for (int x = 0; x < cols; x += WORD_BITS) {
+            uint64_t cells = golLoadCells(row, x0 + x, words);
+            int n = cols - x < WORD_BITS ? cols - x : WORD_BITS;
+            switch (format) {
+                case GOL_VTK_UINT8:
+                    for (int b = 0; b < n; b++) out[k++] = (cells >> b) & 1;
+                    break;
+                case GOL_VTK_BIT:
+                    // vtkBitArray order: the first value is the most significant bit of a byte
+                    for (int b = 0; b < n; b++, k++) out[k / 8] |= ((cells >> b) & 1) << (7 - k % 8);
+                    break;
+                default:
+                    for (int b = 0; b < n; b++) values[k++] = (cells >> b) & 1;
+                    break;
+            }
+        }
+    }
+    return size;
+}
+
+void golVtkWriteCells(FILE *fp, const uint64_t *grid, int words, int x0, int y0, int cols, int rows,
+                      GolVtkFormat format, int compress) {
+    uint64_t size = golVtkPayloadSize((uint64_t) cols * rows, format);
+    unsigned char *payload = malloc(size > 0 ? size : 1);
+    golVtkEncode(grid, words, x0, y0, cols, rows, format, payload);
+
+    fprintf(fp, "<AppendedData encoding=\"raw\">\n");
+    fprintf(fp, "_");
+    if (!compress) {
+        fwrite(&size, sizeof(uint64_t), 1, fp);
+        fwrite(payload, 1, size, fp);
+    } else {
+        // header: block count, block size, size of the last block, compressed size of every block
+        uint64_t blocks = (size + ZLIB_BLOCK - 1) / ZLIB_BLOCK;
+        uint64_t *header = malloc((3 + blocks) * sizeof(uint64_t));
+        uLong bound = compressBound(ZLIB_BLOCK);
+        unsigned char *compressed = malloc(blocks * bound + 1);
+        uint64_t total = 0;
+        header[0] = blocks;
+        header[1] = ZLIB_BLOCK;
+        header[2] = blocks > 0 ? size - (blocks - 1) * ZLIB_BLOCK : 0;
+        for (uint64_t i = 0; i < blocks; i++) {
+            uLongf length = bound;
+            uLong bytes = i + 1 < blocks ? ZLIB_BLOCK : header[2];
+            compress2(compressed + total, &length, payload + i * ZLIB_BLOCK, bytes, Z_BEST_SPEED);
+            header[3 + i] = length;
+            total += length;
+        }
+        fwrite(header, sizeof(uint64_t), 3 + blocks, fp);
+        fwrite(compressed, 1, total, fp);
+        free(header);
+        free(compressed);
+    }
+    fprintf(fp, "\n</AppendedData>\n");
+    free(payload);
+}
@@ -0,0 +1,56 @@
+#ifndef GOL_VTK_H
+#define GOL_VTK_H
+
+#include <stdint.h>
+#include <stdio.h>
+
+/**
+ * Cell payload of the .vti files shared by the OpenMP and the MPI build.
+ *
+ * The cells of a piece are converted into one contiguous buffer and written with a single call instead of one fwrite
+ * per cell. Float32 is the original format, UInt8 stores one byte and Bit one bit per cell. The appended data can be
+ * zlib-compressed in the block layout of vtkZLibDataCompressor, which ParaView reads directly.
+ */
+
+typedef enum {
+    GOL_VTK_FLOAT32,
+    GOL_VTK_UINT8,
+    GOL_VTK_BIT,
+    GOL_VTK_FORMAT_COUNT
+} GolVtkFormat;
+
+/**
+ * Picks the payload format by name ("float32", "uint8", "bit"), NULL selects Float32.
+ */
+GolVtkFormat golSelectVtkFormat(const char *name);
+
+/**
+ * The VTK type name of a format, used for the type attribute of (P)DataArray.
+ */
+const char *golVtkTypeName(GolVtkFormat format);
+
+/**
+ * The compressor attribute of the VTKFile element, empty without compression.
+ */
+const char *golVtkCompressor(int compress);
+
+/**
+ * Bytes of the payload of `cells` cells.
+ */
+uint64_t golVtkPayloadSize(uint64_t cells, GolVtkFormat format);
+
+/**
+ * Converts the cols x rows cells starting at (x0, y0) of a packed grid with `words` words per row into the payload,
+ * x runs fastest. Returns the number of bytes written to out.
+ */
+uint64_t golVtkEncode(const uint64_t *grid, int words, int x0, int y0, int cols, int rows, GolVtkFormat format,
+                      unsigned char *out);
+
+/**
+ * Writes the AppendedData element holding the cols x rows cells starting at (x0, y0) of a packed grid: the UInt64 byte
+ * count and the raw payload, or the block header and the zlib-compressed blocks.
+ */
+void golVtkWriteCells(FILE *fp, const uint64_t *grid, int words, int x0, int y0, int cols, int rows,
+                      GolVtkFormat format, int compress);
+
+#endif